@@ -0,0 +1,90 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "AsyncWriter.h"
+
+namespace {
+    // Alignement des buffers sur une page
+    constexpr std::size_t Alignment = 4096;
+}
+
+AsyncWriter::AsyncWriter(const std::string &path, std::size_t bufferSize, std::size_t nbBuffer)
+: m_file(path, std::ios::binary | std::ios::trunc)
+, m_bufferSize(bufferSize)
+, m_free(nbBuffer)
+, m_pending(nbBuffer + 1)
+, m_closed(false) {
+    if (m_file.fail()) {
+        m_closed = true;
+        return;
+    }
+
+    // Les gros blocs sont écrits directement, sans passer par le buffer du flux
+    m_file.rdbuf()->pubsetbuf(nullptr, 0);
+
+    const std::size_t bytes = (bufferSize * sizeof(std::int64_t) + Alignment - 1) / Alignment * Alignment;
+    for (std::size_t i = 0; i < nbBuffer; ++i) {
+        m_buffers.emplace_back(static_cast<std::int64_t *>(std::aligned_alloc(Alignment, bytes)));
+        m_free.push(m_buffers.back().get());
+    }
+
+    m_thread = std::thread(&AsyncWriter::run, this);
+}
+
+AsyncWriter::~AsyncWriter() {
+    close();
+}
+
+bool AsyncWriter::isOpen() const {
+    return m_file.is_open();
+}
+
+std::size_t AsyncWriter::getBufferSize() const {
+    return m_bufferSize;
+}
+
+std::int64_t *AsyncWriter::acquire() {
+    return m_free.pop();
+}
+
+void AsyncWriter::commit(std::int64_t *buffer, std::size_t size) {
+    m_pending.push({ buffer, size });
+}
+
+bool AsyncWriter::close() {
+    if (!m_closed) {
+        m_pending.push({ nullptr, 0 });
+        m_thread.join();
+        m_file.close();
+        m_closed = true;
+    }
+
+    return !m_file.fail();
+}
+
+void AsyncWriter::run() {
+    for (;;) {
+        Pending pending = m_pending.pop();
+        if (pending.buffer == nullptr) {
+            break;
+        }
+
+        m_file.write(reinterpret_cast<const char *>(pending.buffer), pending.size * sizeof(std::int64_t));
+        m_free.push(pending.buffer);
+    }
+}
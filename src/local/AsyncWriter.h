@@ -0,0 +1,120 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H
+
+#include <cinttypes>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SpscQueue.h"
+
+/**
+ * @brief Binary file written by a background thread
+ * The producer fills large page aligned buffers of int64 samples and hands
+ * them to the writer thread, which gives them back once written. The
+ * producer only waits when all the buffers are being written, and the
+ * writer thread sleeps while no buffer is pending (see SpscQueue). The
+ * default buffers are small enough to stay in the cache between the
+ * producer and the write.
+ */
+class AsyncWriter {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param path Path of the file (truncated)
+     * @param bufferSize Number of samples of each buffer
+     * @param nbBuffer Number of buffers
+     */
+    AsyncWriter(const std::string &path, std::size_t bufferSize = 1 << 16, std::size_t nbBuffer = 4);
+
+    AsyncWriter(const AsyncWriter &) = delete;
+    AsyncWriter &operator=(const AsyncWriter &) = delete;
+
+    /**
+     * @brief Destructor, finish the pending writes
+     */
+    ~AsyncWriter();
+
+    /**
+     * @brief Check if the file could be opened
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Get the number of samples of a buffer
+     */
+    std::size_t getBufferSize() const;
+
+    /**
+     * @brief Get a free buffer to fill (producer thread only)
+     */
+    std::int64_t *acquire();
+
+    /**
+     * @brief Write a filled buffer (producer thread only)
+     *
+     * @param buffer Buffer returned by acquire()
+     * @param size Number of samples to write
+     */
+    void commit(std::int64_t *buffer, std::size_t size);
+
+    /**
+     * @brief Finish the pending writes and close the file
+     *
+     * @return false if a write failed
+     */
+    bool close();
+
+private:
+    /**
+     * @brief Buffer waiting to be written
+     */
+    struct Pending {
+        std::int64_t *buffer;   /*!< Samples (null to stop the thread) */
+        std::size_t size;       /*!< Number of samples */
+    };
+
+    struct Deleter {
+        void operator()(std::int64_t *buffer) const {
+            std::free(buffer);
+        }
+    };
+
+    /**
+     * @brief Body of the writer thread
+     */
+    void run();
+
+private:
+    std::ofstream m_file;
+    std::size_t m_bufferSize;
+    std::vector< std::unique_ptr<std::int64_t, Deleter> > m_buffers;
+    SpscQueue<std::int64_t *> m_free;
+    SpscQueue<Pending> m_pending;
+    std::thread m_thread;
+    bool m_closed;
+};
+
+#endif // ASYNC_WRITER_H
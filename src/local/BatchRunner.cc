@@ -0,0 +1,515 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "BatchRunner.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <nlohmann/json.hpp>
+
+#include "CachedSolution.h"
+#include "DynamicProgram.h"
+#include "FilterBank.h"
+#ifdef WITH_GUROBI
+#include "LayeredFlow.h"
+#include "MaximizeRejection.h"
+#include "MinimizeArea.h"
+#include "QuadraticProgram.h"
+#endif
+#include "ScriptGenerator.h"
+#include "TclPRN.h"
+
+using json = nlohmann::json;
+
+namespace {
+    bool createDirectory(const std::string &path) {
+        const int dir_err = ::mkdir(path.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+        if (-1 == dir_err && errno != EEXIST) {
+            return false;
+        }
+
+        return true;
+    }
+
+    double cascadeArea(const std::vector<SelectedFilter> &filters) {
+        double area = 0.0;
+        for (const SelectedFilter &filter: filters) {
+            area += filter.filter.getCardC() * (filter.filter.getPiC() + filter.piIn);
+        }
+        return area;
+    }
+
+    double cascadeRejection(const std::vector<SelectedFilter> &filters) {
+        double rejection = 0.0;
+        for (const SelectedFilter &filter: filters) {
+            rejection += filter.rejection;
+        }
+        return rejection;
+    }
+
+    /**
+     * Error of a job found before solving it, empty if the job is valid
+     */
+    std::string checkJob(const SolverJob &job) {
+#ifdef WITH_GUROBI
+        const bool validEngine = (job.engine == "dp" || job.engine == "gurobi");
+#else
+        const bool validEngine = (job.engine == "dp");
+#endif
+        if (!validEngine) {
+            return "'" + job.engine + "' is not a valid engine";
+        }
+
+        if (job.formulation != "quadratic" && job.formulation != "compact" && job.formulation != "flow") {
+            return "'" + job.formulation + "' is not a valid formulation";
+        }
+
+        if (job.engine == "dp" && !job.verifyCache.empty()) {
+            return "The verification of '" + job.experimentName + "' needs the Gurobi engine";
+        }
+
+        if (job.firstStage < 1 || job.lastStage < job.firstStage) {
+            return "The number of stages of '" + job.experimentName + "' must be at least 1";
+        }
+
+        const bool validLibrary = (FilterBank::isFilterBank(job.jsonPath)) ? FilterBank(job.jsonPath).isOpen() : std::ifstream(job.jsonPath).good();
+        if (!validLibrary) {
+            return "The filter library '" + job.jsonPath + "' is missing or not valid";
+        }
+
+        return std::string();
+    }
+
+    /**
+     * Result of a job for the final report
+     */
+    struct JobResult {
+        bool feasible = false;
+        double time = 0.0;
+        double area = 0.0;
+        double rejection = 0.0;
+        std::string error;
+    };
+
+    /**
+     * Jobs waiting on a worker
+     */
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::size_t> jobs;
+    };
+}
+
+BatchRunner::BatchRunner(const std::string &jobsPath, const std::string &cacheDirectory) {
+    std::ifstream jobsFile(jobsPath, std::ios::binary);
+    if (jobsFile.fail()) {
+        std::cerr << "BatchRunner::BatchRunner: The json file '" << jobsPath << "' is missing" << std::endl;
+        std::exit(-1);
+    }
+
+    json jsonData;
+    jobsFile >> jsonData;
+
+#ifdef WITH_GUROBI
+    const std::string defaultEngine = "gurobi";
+#else
+    const std::string defaultEngine = "dp";
+#endif
+
+    for (const json &element: jsonData) {
+        if (!element.contains("mode") || !element.contains("stages") || !element.contains("limit") || !element.contains("filters") || !element.contains("name")) {
+            std::cerr << "BatchRunner::BatchRunner: A job needs 'mode', 'stages', 'limit', 'filters' and 'name': " << element << std::endl;
+            std::exit(-1);
+        }
+
+        SolverJob job;
+        job.engine = element.value("engine", defaultEngine);
+        job.formulation = element.value("formulation", std::string("quadratic"));
+        job.milpOption = "--" + element["mode"].get<std::string>();
+        job.constraintLimit = element["limit"].get<double>();
+        job.jsonPath = element["filters"].get<std::string>();
+        job.experimentName = element["name"].get<std::string>();
+        job.cacheDirectory = element.value("cache", cacheDirectory);
+        job.verifyCache = element.value("verify", std::string());
+        job.debugLp = element.value("debug_lp", false);
+
+        // Un nombre d'étages ou un intervalle "FIRST..LAST"
+        const json &stages = element["stages"];
+        if (stages.is_number_integer()) {
+            job.firstStage = stages.get<std::int64_t>();
+            job.lastStage = job.firstStage;
+        }
+        else {
+            std::string range = stages.get<std::string>();
+            std::size_t separator = range.find("..");
+            if (separator == std::string::npos) {
+                std::cerr << "BatchRunner::BatchRunner: '" << range << "' is not a valid stage range" << std::endl;
+                std::exit(-1);
+            }
+            job.firstStage = std::stoul(range.substr(0, separator));
+            job.lastStage = std::stoul(range.substr(separator + 2));
+        }
+
+        if (job.milpOption != "--max_rej" && job.milpOption != "--min_area") {
+            std::cerr << "BatchRunner::BatchRunner: '" << element["mode"] << "' is not a valid mode" << std::endl;
+            std::exit(-1);
+        }
+
+        // Les erreurs connues avant la résolution arrêtent le batch avant son lancement
+        const std::string error = checkJob(job);
+        if (!error.empty()) {
+            std::cerr << "BatchRunner::BatchRunner: " << error << std::endl;
+            std::exit(-1);
+        }
+
+        m_jobs.push_back(job);
+    }
+}
+
+bool BatchRunner::run(std::size_t nbThreads) {
+    nbThreads = std::max<std::size_t>(1, std::min(nbThreads, m_jobs.size()));
+
+    // Répartition initiale des jobs
+    std::vector<WorkQueue> queues(nbThreads);
+    for (std::size_t job = 0; job < m_jobs.size(); ++job) {
+        queues[job % nbThreads].jobs.push_back(job);
+    }
+
+    // Prend le premier job de sa file, sinon vole le dernier job d'une autre file
+    auto nextJob = [&](std::size_t worker, std::size_t &job) {
+        for (std::size_t k = 0; k < nbThreads; ++k) {
+            WorkQueue &queue = queues[(worker + k) % nbThreads];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.jobs.empty()) {
+                continue;
+            }
+
+            if (k == 0) {
+                job = queue.jobs.front();
+                queue.jobs.pop_front();
+            }
+            else {
+                job = queue.jobs.back();
+                queue.jobs.pop_back();
+            }
+            return true;
+        }
+        return false;
+    };
+
+    std::vector<JobResult> results(m_jobs.size());
+
+    auto worker = [&](std::size_t id) {
+        SolverEnv *env = nullptr;
+#ifdef WITH_GUROBI
+        // Un environnement Gurobi par thread, les coeurs sont partagés entre les threads
+        const unsigned int nbCores = std::max(1u, std::thread::hardware_concurrency());
+        std::unique_ptr<GRBEnv> workerEnv;
+#endif
+
+        std::size_t job = 0;
+        while (nextJob(id, job)) {
+            JobResult &result = results[job];
+            auto tStart = std::chrono::high_resolution_clock::now();
+
+            // Une erreur pendant la résolution n'arrête que son job
+            try {
+#ifdef WITH_GUROBI
+                // Créé au premier job Gurobi : sans licence, seuls ces jobs échouent
+                if (m_jobs[job].engine == "gurobi" && !workerEnv) {
+                    std::unique_ptr<GRBEnv> newEnv(new GRBEnv());
+                    newEnv->set(GRB_IntParam_OutputFlag, 0);
+                    newEnv->set(GRB_IntParam_Threads, std::max<int>(1, nbCores / nbThreads));
+                    workerEnv = std::move(newEnv);
+                    env = workerEnv.get();
+                }
+#endif
+                std::unique_ptr<CascadeSolver> milp(solveJob(m_jobs[job], env));
+                if (milp) {
+                    result.feasible = true;
+                    result.area = cascadeArea(milp->getSelectedFilters());
+                    result.rejection = cascadeRejection(milp->getSelectedFilters());
+                    if (writeResults(*milp, m_jobs[job].experimentName)) {
+                        std::ostringstream debug;
+                        milp->printDebugFiles(debug);
+                    }
+                    else {
+                        result.error = "create directory failed";
+                    }
+                }
+#ifdef WITH_GUROBI
+            } catch (GRBException e) {
+                result.error = e.getMessage();
+#endif
+            } catch (const std::exception &e) {
+                result.error = e.what();
+            }
+
+            auto tEnd = std::chrono::high_resolution_clock::now();
+            result.time = std::chrono::duration<double>(tEnd-tStart).count();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t id = 0; id < nbThreads; ++id) {
+        threads.emplace_back(worker, id);
+    }
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+
+    // Résumé des jobs
+    bool success = true;
+    std::cout << std::endl;
+    std::cout << "### Batch results ###" << std::endl;
+    for (std::size_t job = 0; job < m_jobs.size(); ++job) {
+        const JobResult &result = results[job];
+        std::cout << m_jobs[job].experimentName << ": " << result.time << " seconds, ";
+        if (!result.error.empty()) {
+            std::cout << "error: " << result.error << std::endl;
+            success = false;
+        }
+        else if (!result.feasible) {
+            std::cout << "no feasible cascade" << std::endl;
+            success = false;
+        }
+        else {
+            std::cout << "area = " << result.area << ", rejection = " << result.rejection << std::endl;
+        }
+    }
+
+    return success;
+}
+
+CascadeSolver *BatchRunner::createSolver(const SolverJob &job, const std::int64_t nbStage, SolverEnv *env) {
+    if (job.engine == "dp") {
+        if (!job.verifyCache.empty()) {
+            throw std::runtime_error("BatchRunner::createSolver: The verification of '" + job.experimentName + "' needs the Gurobi engine");
+        }
+        DynamicProgram::Mode mode = (job.milpOption == "--max_rej") ? DynamicProgram::Mode::MaximizeRejection : DynamicProgram::Mode::MinimizeArea;
+        return new DynamicProgram(mode, nbStage, job.constraintLimit, job.jsonPath, job.experimentName);
+    }
+#ifdef WITH_GUROBI
+    QuadraticProgram *program = nullptr;
+    if (job.engine == "gurobi" && job.formulation == "flow") {
+        LayeredFlow::Mode mode = (job.milpOption == "--max_rej") ? LayeredFlow::Mode::MaximizeRejection : LayeredFlow::Mode::MinimizeArea;
+        program = new LayeredFlow(mode, nbStage, job.constraintLimit, job.jsonPath, job.experimentName, env, job.debugLp);
+    }
+    else if (job.engine == "gurobi" && (job.formulation == "quadratic" || job.formulation == "compact") && job.milpOption == "--max_rej") {
+        program = new MaximizeRejection(nbStage, job.constraintLimit, job.jsonPath, job.experimentName, env, job.debugLp, job.formulation == "compact");
+    }
+    else if (job.engine == "gurobi" && (job.formulation == "quadratic" || job.formulation == "compact") && job.milpOption == "--min_area") {
+        program = new MinimizeArea(nbStage, job.constraintLimit, job.jsonPath, job.experimentName, env, job.debugLp, job.formulation == "compact");
+    }
+
+    // Vérification de chaque cascade par la réponse de ses coefficients
+    if (program != nullptr && !job.verifyCache.empty() && !program->setVerification(job.verifyCache)) {
+        delete program;
+        throw std::runtime_error("BatchRunner::createSolver: The cascades of '" + job.experimentName + "' can not be verified with '" + job.verifyCache + "'");
+    }
+
+    return program;
+#else
+    (void)env;
+
+    return nullptr;
+#endif
+}
+
+CascadeSolver *BatchRunner::solveJob(const SolverJob &job, SolverEnv *env) {
+    CascadeSolver *best = nullptr;
+    CascadeSolver *previous = nullptr;
+    std::int64_t bestStage = 0;
+    std::ostringstream summary;
+
+    // Un solveur encore alloué est libéré si la résolution échoue
+    CascadeSolver *milp = nullptr;
+    try {
+        for (std::int64_t nbStage = job.firstStage; nbStage <= job.lastStage; ++nbStage) {
+            auto tStart = std::chrono::high_resolution_clock::now();
+
+            // Solution déjà calculée
+            milp = nullptr;
+            bool feasible = false;
+            std::unique_ptr<CachedSolution> cached;
+            // Le cache ne distingue pas les cascades vérifiées
+            if (!job.cacheDirectory.empty() && job.verifyCache.empty()) {
+                cached.reset(new CachedSolution(job.cacheDirectory, job.engine, job.formulation, job.milpOption, nbStage, job.constraintLimit, job.jsonPath, job.experimentName));
+                feasible = cached->solve();
+            }
+
+            if (cached && cached->isHit()) {
+                milp = cached.release();
+            }
+            else {
+                milp = createSolver(job, nbStage, env);
+                if (milp == nullptr) {
+                    throw std::runtime_error("'" + job.engine + "' (" + job.formulation + ") is not a valid engine");
+                }
+
+                if (previous != nullptr) {
+                    milp->setStart(previous->getSelectedFilters());
+                }
+                feasible = milp->solve();
+
+                if (cached) {
+                    cached->store(*milp, feasible);
+                }
+            }
+
+            auto tEnd = std::chrono::high_resolution_clock::now();
+            double time = std::chrono::duration<double>(tEnd-tStart).count();
+
+            summary << "NUMBER_STAGE = " << nbStage << ": " << time << " seconds, ";
+            if (!feasible) {
+                summary << "no feasible cascade" << std::endl;
+                delete milp;
+                continue;
+            }
+
+            double area = cascadeArea(milp->getSelectedFilters());
+            double rejection = cascadeRejection(milp->getSelectedFilters());
+            summary << "area = " << area << ", rejection = " << rejection << std::endl;
+
+            // Garde le nombre d'étages le plus faible en cas d'égalité
+            bool better = (best == nullptr);
+            if (!better && job.milpOption == "--max_rej") {
+                better = rejection > cascadeRejection(best->getSelectedFilters()) + 1e-9;
+            }
+            else if (!better) {
+                better = area < cascadeArea(best->getSelectedFilters()) - 1e-9;
+            }
+
+            // Seuls le meilleur solveur et le précédent restent alloués
+            CascadeSolver *newBest = (better) ? milp : best;
+            if (previous != nullptr && previous != newBest) {
+                delete previous;
+            }
+            if (best != nullptr && best != previous && best != newBest) {
+                delete best;
+            }
+            if (better) {
+                bestStage = nbStage;
+            }
+            best = newBest;
+            previous = milp;
+        }
+    } catch (...) {
+        if (milp != nullptr && milp != previous && milp != best) {
+            delete milp;
+        }
+        if (previous != nullptr && previous != best) {
+            delete previous;
+        }
+        delete best;
+        throw;
+    }
+
+    if (previous != nullptr && previous != best) {
+        delete previous;
+    }
+
+    if (job.firstStage != job.lastStage) {
+        std::cout << std::endl;
+        std::cout << "### Stage sweep (" << job.experimentName << ") ###" << std::endl;
+        std::cout << summary.str();
+        if (best != nullptr) {
+            std::cout << "Best NUMBER_STAGE = " << bestStage << std::endl;
+        }
+    }
+
+    return best;
+}
+
+bool BatchRunner::sweepLimits(const SolverJob &job, const std::vector<double> &limits, SolverEnv *env) {
+    std::unique_ptr<CascadeSolver> milp;
+    std::ostringstream summary;
+    bool found = false;
+
+    for (double limit: limits) {
+        auto tStart = std::chrono::high_resolution_clock::now();
+
+        // Mise à jour du modèle existant si possible
+        bool updated = false;
+#ifdef WITH_GUROBI
+        QuadraticProgram *program = dynamic_cast<QuadraticProgram *>(milp.get());
+        if (program != nullptr) {
+            updated = program->updateLimit(limit, program->getPiIn());
+        }
+#endif
+        if (!updated) {
+            SolverJob point = job;
+            point.constraintLimit = limit;
+            milp.reset(createSolver(point, job.firstStage, env));
+            if (!milp) {
+                throw std::runtime_error("'" + job.engine + "' (" + job.formulation + ") is not a valid engine");
+            }
+        }
+        bool feasible = milp->solve();
+
+        auto tEnd = std::chrono::high_resolution_clock::now();
+        double time = std::chrono::duration<double>(tEnd-tStart).count();
+
+        summary << "LIMIT = " << limit << ": " << time << " seconds (" << (updated ? "updated" : "new") << " model), ";
+        if (!feasible) {
+            summary << "no feasible cascade" << std::endl;
+            continue;
+        }
+
+        found = true;
+        summary << "area = " << cascadeArea(milp->getSelectedFilters()) << ", rejection = " << cascadeRejection(milp->getSelectedFilters()) << std::endl;
+    }
+
+    std::cout << std::endl;
+    std::cout << "### Limit sweep (NUMBER_STAGE = " << job.firstStage << ") ###" << std::endl;
+    std::cout << summary.str();
+
+    return found;
+}
+
+bool BatchRunner::writeResults(CascadeSolver &milp, const std::string &experimentName) {
+    // Création du répertoire de destination
+    if (!createDirectory(experimentName)) {
+        std::cerr << "createDirectory(): create '" << experimentName << "' directory: failed" << std::endl;
+        return false;
+    }
+
+    milp.printResults("sol.txt");
+
+    TclPRN tcl;
+    tcl.generate(milp, experimentName);
+
+    ScriptGenerator::generateDeployScript(milp, experimentName, "prn");
+    ScriptGenerator::generateSimulationScript(milp, experimentName);
+    if (createDirectory(experimentName + "/simulator")) {
+        ScriptGenerator::generateSimulatorSource(milp, experimentName);
+    }
+
+    return true;
+}
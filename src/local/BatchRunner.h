@@ -0,0 +1,135 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+#ifdef WITH_GUROBI
+#include <gurobi_c++.h>
+#endif
+
+#include "CascadeSolver.h"
+
+#ifdef WITH_GUROBI
+using SolverEnv = GRBEnv;
+#else
+struct SolverEnv {};
+#endif
+
+/**
+ * @brief Description of one problem to solve
+ */
+struct SolverJob {
+    std::string engine;             /*!< Solver engine (gurobi or dp) */
+    std::string formulation;        /*!< Gurobi formulation (quadratic, compact or flow) */
+    std::string milpOption;         /*!< Criterion (--max_rej or --min_area) */
+    std::int64_t firstStage;        /*!< Smallest number of stages */
+    std::int64_t lastStage;         /*!< Largest number of stages */
+    double constraintLimit;         /*!< Area max or rejection min */
+    std::string jsonPath;           /*!< Path to the filters description */
+    std::string experimentName;     /*!< Name of experiment */
+    std::string cacheDirectory;     /*!< Directory of the solution cache (empty to disable it) */
+    std::string verifyCache;        /*!< Response cache verifying the Gurobi cascades (empty to disable it) */
+    bool debugLp;                   /*!< Name the Gurobi model and write its LP file */
+};
+
+/**
+ * @brief Solve a list of jobs on a pool of threads
+ * The jobs are spread over the workers, and an idle worker steals the last
+ * job of another one. Each worker owns one Gurobi environnement, which is not
+ * thread safe, and the filter libraries are read once by process.
+ */
+class BatchRunner {
+public:
+    /**
+     * @brief Constructor
+     * The process exits if a job is not valid: unknown engine or formulation,
+     * verification with the dp engine, empty stage range or missing filter
+     * library.
+     *
+     * @param jobsPath JSON file listing the jobs
+     * @param cacheDirectory Solution cache of the jobs without their own one (empty to disable it)
+     */
+    BatchRunner(const std::string &jobsPath, const std::string &cacheDirectory = "");
+
+    /**
+     * @brief Solve all the jobs and write their results
+     * An error while solving a job is reported in the summary of the batch,
+     * the other jobs are still solved.
+     *
+     * @param nbThreads Number of workers
+     * @return true if all the jobs found a cascade
+     */
+    bool run(std::size_t nbThreads);
+
+    /**
+     * @brief Create the solver of a job
+     *
+     * @param job Job to solve
+     * @param nbStage Number of stages
+     * @param env Gurobi environnement to share (a new one is created if null)
+     * @return The solver, or null if the engine is not valid
+     * @throw std::runtime_error if the filter library can not be read or the cascades can not be verified
+     */
+    static CascadeSolver *createSolver(const SolverJob &job, const std::int64_t nbStage, SolverEnv *env);
+
+    /**
+     * @brief Solve each number of stages of a job and return the best solver
+     * The optimum with k stages is the starting point of the problem with
+     * k + 1 stages: its last stage is left empty.
+     * With a cache directory, the cached problems are not solved again.
+     *
+     * @param job Job to solve
+     * @param env Gurobi environnement to share (a new one is created if null)
+     * @return The best solver, or null if no cascade was found
+     * @throw std::runtime_error if the engine is not valid or a solver can not be created
+     */
+    static CascadeSolver *solveJob(const SolverJob &job, SolverEnv *env);
+
+    /**
+     * @brief Solve the first number of stages of a job for several limits
+     * With Gurobi, the model is built once and only its constraint limit is
+     * updated between two solves (it is rebuilt if it can not be updated).
+     *
+     * @param job Job to solve (its constraint limit is ignored)
+     * @param limits Area max or rejection min of each solve
+     * @param env Gurobi environnement to share (a new one is created if null)
+     * @return true if at least one limit has a feasible cascade
+     * @throw std::runtime_error if the engine is not valid or a solver can not be created
+     */
+    static bool sweepLimits(const SolverJob &job, const std::vector<double> &limits, SolverEnv *env);
+
+    /**
+     * @brief Write the result file, the Tcl project and the scripts
+     * The experiment directory is created if needed.
+     *
+     * @param milp The solved cascade
+     * @param experimentName Name of experiment
+     * @return false if the experiment directory can not be created
+     */
+    static bool writeResults(CascadeSolver &milp, const std::string &experimentName);
+
+private:
+    std::vector<SolverJob> m_jobs;
+};
+
+#endif // BATCH_RUNNER_H
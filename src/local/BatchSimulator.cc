@@ -0,0 +1,275 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "BatchSimulator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include "MappedFile.h"
+
+namespace {
+    // Number of samples filtered by all the cascades of a thread before the next ones
+    constexpr std::size_t BlockSize = 1 << 16;
+
+    // Size of the frames of the spectrum
+    constexpr std::size_t FrameSize = 2048;
+}
+
+BatchSimulator::BatchSimulator(const std::string &cascadesFile, const FilterBank *bank)
+: m_bank(bank)
+, m_nbSample(0)
+, m_time(0.0) {
+    std::ifstream file(cascadesFile);
+    if (file.fail()) {
+        std::cerr << "BatchSimulator::BatchSimulator: The cascade file '" << cascadesFile << "' is missing" << std::endl;
+        std::exit(-1);
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream tokens(line);
+        std::string command, inputFile, outputFile;
+        tokens >> command >> inputFile >> outputFile;
+
+        // Seules les commandes du simulateur décrivent une cascade
+        const std::string program = "cascaded-filters";
+        if (command.size() < program.size() || command.compare(command.size() - program.size(), program.size(), program) != 0) {
+            continue;
+        }
+
+        Cascade cascade;
+        SimulationStage stage;
+        while (tokens >> stage.coefficientFile >> stage.shift >> stage.piOut) {
+            cascade.stages.push_back(stage);
+            cascade.description += (cascade.description.empty() ? "" : " ") + stage.coefficientFile + " " + std::to_string(stage.shift) + " " + std::to_string(stage.piOut);
+        }
+        if (cascade.stages.empty()) {
+            continue;
+        }
+        m_cascades.push_back(cascade);
+    }
+
+    if (m_cascades.empty()) {
+        std::cerr << "BatchSimulator::BatchSimulator: No simulator command in '" << cascadesFile << "'" << std::endl;
+        std::exit(-1);
+    }
+}
+
+std::size_t BatchSimulator::getNbCascade() const {
+    return m_cascades.size();
+}
+
+bool BatchSimulator::simulate(const std::string &inputFile, std::size_t nbThreads, double fc) {
+    MappedFile input(inputFile);
+    if (!input.isOpen()) {
+        std::cerr << "BatchSimulator::simulate: open '" << inputFile << "': failed" << std::endl;
+        return false;
+    }
+
+    auto tStart = std::chrono::high_resolution_clock::now();
+
+    buildTree();
+    if (nbThreads == 0) {
+        nbThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    nbThreads = std::min(nbThreads, m_roots.size());
+
+    // Répartition des sous-arbres les plus longs d'abord sur le thread le moins chargé
+    std::vector<std::size_t> roots = m_roots;
+    std::sort(roots.begin(), roots.end(), [this](std::size_t lhs, std::size_t rhs) {
+        return getCost(lhs) > getCost(rhs);
+    });
+    std::vector<Worker> workers(nbThreads);
+    std::vector<std::uint64_t> loads(nbThreads, 0);
+    for (std::size_t root: roots) {
+        const std::size_t t = std::min_element(loads.begin(), loads.end()) - loads.begin();
+        workers[t].roots.push_back(root);
+        loads[t] += getCost(root);
+    }
+
+    std::size_t depth = 0;
+    for (const Cascade &cascade: m_cascades) {
+        depth = std::max(depth, cascade.stages.size());
+    }
+
+    const std::int64_t *samples = reinterpret_cast<const std::int64_t *>(input.getData());
+    m_nbSample = input.getSize() / sizeof(std::int64_t);
+
+    // Deux cascades partagent une FFT complexe, le spectre de l'entrée est calculé une seule fois
+    std::vector<std::thread> threads;
+    for (Worker &worker: workers) {
+        for (std::size_t root: worker.roots) {
+            collectCascades(root, worker.terminals);
+        }
+        worker.buffers.assign(depth, std::vector<std::int64_t>(BlockSize));
+        worker.pending.resize(BlockSize);
+        worker.zeros.assign(BlockSize, 0);
+        worker.spectra.assign((worker.terminals.size() + 1) / 2, SpectrumAnalyzer(FrameSize));
+
+        threads.emplace_back([&]() {
+            // Chaque bloc d'entrée est filtré par toutes les cascades du thread pendant qu'il est dans le cache
+            for (std::uint64_t position = 0; position < m_nbSample; position += BlockSize) {
+                const std::size_t size = std::min<std::uint64_t>(BlockSize, m_nbSample - position);
+                worker.nbTerminal = 0;
+                for (std::size_t root: worker.roots) {
+                    processNode(root, samples + position, size, 0, worker);
+                }
+                if (worker.nbTerminal % 2 == 1) {
+                    worker.spectra.back().add(worker.pending.data(), worker.zeros.data(), size);
+                }
+            }
+        });
+    }
+
+    SpectrumAnalyzer inputSpectrum(FrameSize);
+    for (std::uint64_t position = 0; position < m_nbSample; position += BlockSize) {
+        const std::size_t size = std::min<std::uint64_t>(BlockSize, m_nbSample - position);
+        inputSpectrum.add(samples + position, samples + position, size);
+    }
+
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+
+    // Réponse de chaque cascade : spectre de sa sortie sur celui de l'entrée
+    const std::vector<double> &inputMagnitude = inputSpectrum.getInputMagnitude();
+    for (const Worker &worker: workers) {
+        for (std::size_t i = 0; i < worker.terminals.size(); ++i) {
+            const SpectrumAnalyzer &spectrum = worker.spectra[i / 2];
+            const std::vector<double> &outputMagnitude = (i % 2 == 0) ? spectrum.getInputMagnitude() : spectrum.getOutputMagnitude();
+            std::vector<double> response(inputMagnitude.size(), 0.0);
+            for (std::size_t k = 0; k < response.size(); ++k) {
+                if (inputMagnitude[k] > 0.0) {
+                    response[k] = outputMagnitude[k] / inputMagnitude[k];
+                }
+            }
+            m_cascades[worker.terminals[i]].measurement = SpectrumAnalyzer::measure(response, fc, spectrum.getNbFrame());
+        }
+    }
+
+    for (Cascade &cascade: m_cascades) {
+        cascade.overflows.clear();
+        for (std::size_t node: cascade.path) {
+            cascade.overflows.push_back(m_nodes[node].simulator->getOverflows().front());
+        }
+    }
+
+    auto tEnd = std::chrono::high_resolution_clock::now();
+    m_time = std::chrono::duration<double>(tEnd-tStart).count();
+
+    return true;
+}
+
+void BatchSimulator::printResults(std::ostream &out) const {
+    std::size_t nbStage = 0;
+    for (const Cascade &cascade: m_cascades) {
+        nbStage += cascade.stages.size();
+    }
+
+    out << "Simulated cascades: " << m_cascades.size() << " on " << m_nbSample << " samples (" << m_time << "s)" << std::endl;
+    out << "Computed stages: " << m_nodes.size() << " for " << nbStage << " stages" << std::endl;
+    for (std::size_t c = 0; c < m_cascades.size(); ++c) {
+        const Cascade &cascade = m_cascades[c];
+        out << "Cascade #" << c << ": " << cascade.description << std::endl;
+        out << "\tMeasured rejection: " << cascade.measurement.rejection << " dB (stopband " << cascade.measurement.stopband << " dB, passband ripple " << cascade.measurement.ripple << " dB)" << std::endl;
+        for (std::size_t s = 0; s < cascade.overflows.size(); ++s) {
+            if (cascade.overflows[s] > 0) {
+                out << "\tStage #" << s << ": " << cascade.overflows[s] << " samples exceed " << cascade.stages[s].piOut << " bits" << std::endl;
+            }
+        }
+    }
+}
+
+void BatchSimulator::buildTree() {
+    m_nodes.clear();
+    m_roots.clear();
+
+    for (std::size_t c = 0; c < m_cascades.size(); ++c) {
+        Cascade &cascade = m_cascades[c];
+        cascade.path.clear();
+
+        // Un étage est partagé si le filtre, le décalage et la taille de sortie sont identiques après les mêmes étages
+        constexpr std::size_t NoParent = static_cast<std::size_t>(-1);
+        std::size_t parent = NoParent;
+        for (const SimulationStage &stage: cascade.stages) {
+            const std::vector<std::size_t> &siblings = (parent == NoParent) ? m_roots : m_nodes[parent].children;
+            auto found = std::find_if(siblings.begin(), siblings.end(), [&](std::size_t node) {
+                const SimulationStage &other = m_nodes[node].stage;
+                return other.coefficientFile == stage.coefficientFile && other.shift == stage.shift && other.piOut == stage.piOut;
+            });
+
+            std::size_t node = 0;
+            if (found != siblings.end()) {
+                node = *found;
+            }
+            else {
+                node = m_nodes.size();
+                Node newNode;
+                newNode.stage = stage;
+                newNode.simulator.reset(new CascadeSimulator(std::vector<SimulationStage>(1, stage), m_bank));
+                m_nodes.push_back(std::move(newNode));
+                ((parent == NoParent) ? m_roots : m_nodes[parent].children).push_back(node);
+            }
+
+            cascade.path.push_back(node);
+            parent = node;
+        }
+        m_nodes[parent].cascades.push_back(c);
+    }
+}
+
+std::uint64_t BatchSimulator::getCost(std::size_t node) const {
+    std::uint64_t cost = m_nodes[node].simulator->getNbCoefficient();
+    for (std::size_t child: m_nodes[node].children) {
+        cost += getCost(child);
+    }
+    return cost;
+}
+
+void BatchSimulator::collectCascades(std::size_t node, std::vector<std::size_t> &terminals) const {
+    terminals.insert(terminals.end(), m_nodes[node].cascades.begin(), m_nodes[node].cascades.end());
+    for (std::size_t child: m_nodes[node].children) {
+        collectCascades(child, terminals);
+    }
+}
+
+void BatchSimulator::processNode(std::size_t node, const std::int64_t *input, std::size_t size, std::size_t depth, Worker &worker) {
+    std::int64_t *output = worker.buffers[depth].data();
+    m_nodes[node].simulator->process(input, output, size);
+
+    // Les sorties sont analysées deux par deux, dans l'ordre de collectCascades
+    for (std::size_t i = 0; i < m_nodes[node].cascades.size(); ++i) {
+        if (worker.nbTerminal % 2 == 0) {
+            std::copy(output, output + size, worker.pending.begin());
+        }
+        else {
+            worker.spectra[worker.nbTerminal / 2].add(worker.pending.data(), output, size);
+        }
+        ++worker.nbTerminal;
+    }
+
+    for (std::size_t child: m_nodes[node].children) {
+        processNode(child, output, size, depth + 1, worker);
+    }
+}
@@ -0,0 +1,150 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef BATCH_SIMULATOR_H
+#define BATCH_SIMULATOR_H
+
+#include <cinttypes>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CascadeSimulator.h"
+#include "SpectrumAnalyzer.h"
+
+/**
+ * @brief Measure many cascades on the same raw data file
+ * The cascades are the simulator commands printed in the result files
+ * ("./cascaded-filters data_prn.bin simu_stage.bin FILE SHIFT PI_OUT ..."),
+ * the other lines are ignored, so several sol.txt can be concatenated. The
+ * cascades are merged in a prefix tree: the stages with the same filter,
+ * shift and output size after the same previous stages are computed once
+ * and their output goes to all the following stages. The input is mapped
+ * once and the subtrees are spread over the threads: each thread reads every
+ * block once for all its cascades. Only the measured rejection and the
+ * overflows are kept, no output file is written.
+ */
+class BatchSimulator {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param cascadesFile File with one simulator command by cascade
+     * @param bank Filter bank of the coefficients (null to read the coefficient files)
+     */
+    BatchSimulator(const std::string &cascadesFile, const FilterBank *bank = nullptr);
+
+    /**
+     * @brief Get the number of cascades
+     */
+    std::size_t getNbCascade() const;
+
+    /**
+     * @brief Simulate all the cascades on a binary file of int64 samples
+     *
+     * @param inputFile Raw data file
+     * @param nbThreads Number of threads (0 for the number of cores)
+     * @param fc Cutoff frequency of the rejection criterion
+     * @return false if the input file can not be opened
+     */
+    bool simulate(const std::string &inputFile, std::size_t nbThreads, double fc);
+
+    /**
+     * @brief Print the measure of each cascade
+     *
+     * @param out Output stream
+     */
+    void printResults(std::ostream &out = std::cout) const;
+
+private:
+    /**
+     * @brief Cascade read from the file and its measure
+     */
+    struct Cascade {
+        std::string description;            /*!< Stages as written in the command */
+        std::vector<SimulationStage> stages;/*!< Stages to simulate */
+        std::vector<std::size_t> path;      /*!< Node of each stage in the prefix tree */
+        SpectrumMeasurement measurement;    /*!< Measured rejection */
+        std::vector<std::uint64_t> overflows;/*!< Samples exceeding pi_out bits by stage */
+    };
+
+    /**
+     * @brief Stage of the prefix tree, shared by all the cascades starting with the same stages
+     */
+    struct Node {
+        SimulationStage stage;                          /*!< Filter, shift and output size */
+        std::unique_ptr<CascadeSimulator> simulator;    /*!< State of the stage */
+        std::vector<std::size_t> children;              /*!< Next stages */
+        std::vector<std::size_t> cascades;              /*!< Cascades ending with this stage */
+    };
+
+    /**
+     * @brief Subtrees simulated by one thread
+     */
+    struct Worker {
+        std::vector<std::size_t> roots;                 /*!< First stages of the subtrees */
+        std::vector<std::size_t> terminals;             /*!< Cascades in the order of the traversal */
+        std::vector< std::vector<std::int64_t> > buffers;/*!< Output of the current stage of each depth */
+        std::vector<std::int64_t> pending;              /*!< Output waiting for its pair in the spectrum */
+        std::vector<std::int64_t> zeros;                /*!< Pair of the last output if it is alone */
+        std::vector<SpectrumAnalyzer> spectra;          /*!< Spectra of the outputs, two by two */
+        std::size_t nbTerminal;                         /*!< Number of outputs of the current block */
+    };
+
+    /**
+     * @brief Merge the cascades in the prefix tree and read the coefficients
+     */
+    void buildTree();
+
+    /**
+     * @brief Get the number of coefficients of a subtree
+     *
+     * @param node Root of the subtree
+     */
+    std::uint64_t getCost(std::size_t node) const;
+
+    /**
+     * @brief List the cascades of a subtree in the order of the traversal
+     *
+     * @param node Root of the subtree
+     * @param terminals Cascades found
+     */
+    void collectCascades(std::size_t node, std::vector<std::size_t> &terminals) const;
+
+    /**
+     * @brief Filter a block by a stage and all its following stages
+     *
+     * @param node Stage
+     * @param input Output of the previous stage
+     * @param size Number of samples
+     * @param depth Depth of the stage
+     * @param worker State of the thread
+     */
+    void processNode(std::size_t node, const std::int64_t *input, std::size_t size, std::size_t depth, Worker &worker);
+
+private:
+    const FilterBank *m_bank;
+    std::vector<Cascade> m_cascades;
+    std::vector<Node> m_nodes;
+    std::vector<std::size_t> m_roots;
+    std::uint64_t m_nbSample;
+    double m_time;
+};
+
+#endif // BATCH_SIMULATOR_H
@@ -0,0 +1,208 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "CachedSolution.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+namespace {
+    // Input size of the models (PRN input)
+    constexpr std::int64_t PiIn = 16;
+
+    // Version of the cache files, to change if their content changes
+    constexpr int CacheVersion = 1;
+
+    /**
+     * FNV-1a hash of a buffer
+     */
+    std::uint64_t hashBytes(std::uint64_t hash, const void *data, std::size_t size) {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+}
+
+CachedSolution::CachedSolution(const std::string &cacheDirectory, const std::string &engine, const std::string &formulation, const std::string &milpOption, const std::int64_t nbStage, const double constraintLimit, const std::string &jsonPath, const std::string &experimentName)
+: CascadeSolver(experimentName)
+, m_cacheDirectory(cacheDirectory)
+, m_hit(false) {
+    // Load all the filter configurations
+    loadFilterLibrary(jsonPath);
+
+    // Empreinte de la bibliothèque de filtres
+    std::uint64_t libraryHash = 14695981039346656037ULL;
+    for (const Fir &fir: m_firs) {
+        const std::string name = fir.getFilterName();
+        const std::uint64_t cardC = fir.getCardC();
+        const std::uint64_t piC = fir.getPiC();
+        const double noiseLevel = fir.getNoiseLevel();
+        libraryHash = hashBytes(libraryHash, name.data(), name.size() + 1);
+        libraryHash = hashBytes(libraryHash, &cardC, sizeof(cardC));
+        libraryHash = hashBytes(libraryHash, &piC, sizeof(piC));
+        libraryHash = hashBytes(libraryHash, &noiseLevel, sizeof(noiseLevel));
+    }
+
+    // Description complète du problème, vérifiée à la lecture en cas de collision
+    std::ostringstream problem;
+    problem.precision(17);
+    problem << "engine=" << engine;
+    problem << ";formulation=" << formulation;
+    problem << ";mode=" << milpOption;
+    problem << ";stages=" << nbStage;
+    problem << ";limit=" << constraintLimit;
+    problem << ";pi_in=" << PiIn;
+#ifdef FIX_REJECTION_CONSTRAINT
+    problem << ";fix_rejection=1";
+#else
+    problem << ";fix_rejection=0";
+#endif
+    problem << ";library=" << std::hex << libraryHash;
+    m_problem = problem.str();
+
+    char filename[32] = {0};
+    std::snprintf(filename, sizeof(filename), "%016llx.json", static_cast<unsigned long long>(hashBytes(14695981039346656037ULL, m_problem.data(), m_problem.size())));
+    m_cachePath = m_cacheDirectory + "/" + filename;
+}
+
+bool CachedSolution::solve() {
+    m_hit = false;
+    m_selectedFilters.clear();
+    m_results.clear();
+
+    std::ifstream cacheFile(m_cachePath, std::ios::binary);
+    if (cacheFile.fail()) {
+        return false;
+    }
+
+    json jsonData = json::parse(cacheFile, nullptr, false);
+    if (jsonData.is_discarded() || jsonData.value("version", 0) != CacheVersion || jsonData.value("problem", std::string()) != m_problem) {
+        return false;
+    }
+
+    std::vector<SelectedFilter> filters;
+    for (const json &element: jsonData["filters"]) {
+        // Recherche du filtre dans la bibliothèque
+        const std::string name = element["name"].get<std::string>();
+        const double noiseLevel = element["noise"].get<double>();
+        std::size_t j = 0;
+        while (j < m_firs.size() && (m_firs[j].getFilterName() != name || m_firs[j].getNoiseLevel() != noiseLevel)) {
+            ++j;
+        }
+        if (j == m_firs.size()) {
+            std::cerr << "CachedSolution::solve: The filter '" << name << "' of '" << m_cachePath << "' is missing" << std::endl;
+            return false;
+        }
+
+        SelectedFilter filter = {
+            element["stage"].get<std::int64_t>(),
+            m_firs[j],
+            element["rejection"].get<double>(),
+            element["shift"].get<std::int64_t>(),
+            element["pi_in"].get<std::int64_t>(),
+            element["pi_fir"].get<std::int64_t>(),
+            element["pi_out"].get<std::int64_t>()
+        };
+        filters.emplace_back(filter);
+    }
+
+    m_hit = true;
+    m_selectedFilters.swap(filters);
+    m_results = jsonData["results"].get<std::string>();
+    std::cout << "Solution read from the cache: " << m_cachePath << std::endl;
+
+    return jsonData["feasible"].get<bool>();
+}
+
+bool CachedSolution::isHit() const {
+    return m_hit;
+}
+
+void CachedSolution::store(CascadeSolver &milp, bool feasible) {
+    std::error_code error;
+    fs::create_directories(m_cacheDirectory, error);
+    if (error) {
+        std::cerr << "CachedSolution::store: create '" << m_cacheDirectory << "' directory: failed" << std::endl;
+        return;
+    }
+
+    json jsonData;
+    jsonData["version"] = CacheVersion;
+    jsonData["problem"] = m_problem;
+    jsonData["feasible"] = feasible;
+    jsonData["filters"] = json::array();
+    if (feasible) {
+        for (const SelectedFilter &filter: milp.getSelectedFilters()) {
+            json element;
+            element["stage"] = filter.stage;
+            element["name"] = filter.filter.getFilterName();
+            element["noise"] = filter.filter.getNoiseLevel();
+            element["rejection"] = filter.rejection;
+            element["shift"] = filter.shift;
+            element["pi_in"] = filter.piIn;
+            element["pi_fir"] = filter.piFir;
+            element["pi_out"] = filter.piOut;
+            jsonData["filters"].push_back(element);
+        }
+
+        std::ostringstream results;
+        milp.printResults(results);
+        jsonData["results"] = results.str();
+    }
+    else {
+        jsonData["results"] = "No feasible cascade\n";
+    }
+
+    // Écriture dans un fichier temporaire propre au thread puis renommage atomique
+    std::ostringstream temporaryPath;
+    temporaryPath << m_cachePath << ".tmp" << ::getpid() << "_" << std::this_thread::get_id();
+    {
+        std::ofstream cacheFile(temporaryPath.str(), std::ios::binary);
+        if (!cacheFile.good()) {
+            std::cerr << "CachedSolution::store: open '" << temporaryPath.str() << "': failed" << std::endl;
+            return;
+        }
+        cacheFile << jsonData.dump(2) << std::endl;
+    }
+    fs::rename(temporaryPath.str(), m_cachePath, error);
+    if (error) {
+        std::cerr << "CachedSolution::store: rename '" << temporaryPath.str() << "': failed" << std::endl;
+        fs::remove(temporaryPath.str(), error);
+    }
+}
+
+const std::vector<SelectedFilter> &CachedSolution::getSelectedFilters() const {
+    return m_selectedFilters;
+}
+
+void CachedSolution::printResults(std::ostream &out) {
+    out << m_results;
+}
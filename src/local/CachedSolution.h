@@ -0,0 +1,97 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef CACHED_SOLUTION_H
+#define CACHED_SOLUTION_H
+
+#include <string>
+
+#include "CascadeSolver.h"
+
+/**
+ * @brief Cascade read from the on-disk solution cache
+ * Each solved problem is stored in a JSON file of the cache directory, named
+ * after a hash of the filter library (after pruning) and of the problem
+ * parameters: engine, formulation, criterion, number of stages, constraint
+ * limit, input size and compilation options. A hit gives the selected filters and the
+ * results of the original solver without building any model.
+ */
+class CachedSolution: public CascadeSolver {
+public:
+    using CascadeSolver::printResults;
+
+    /**
+     * @brief Constructor
+     *
+     * @param cacheDirectory Directory of the cache files
+     * @param engine Solver engine (gurobi or dp)
+     * @param formulation Gurobi formulation (quadratic, compact or flow)
+     * @param milpOption Criterion (--max_rej or --min_area)
+     * @param nbStage Total stage
+     * @param constraintLimit Area max or rejection min
+     * @param jsonPath Path to the filters description
+     * @param experimentName Name of experiment
+     */
+    CachedSolution(const std::string &cacheDirectory, const std::string &engine, const std::string &formulation, const std::string &milpOption, const std::int64_t nbStage, const double constraintLimit, const std::string &jsonPath, const std::string &experimentName);
+
+    /**
+     * @brief Read the cache file of the problem
+     *
+     * @return true if the problem is cached and has a feasible cascade
+     */
+    bool solve() override;
+
+    /**
+     * @brief Check if the problem was found in the cache by solve()
+     * An infeasible problem is also cached.
+     */
+    bool isHit() const;
+
+    /**
+     * @brief Store the result of a solver in the cache
+     * The file is written under a temporary name and renamed, so concurrent
+     * solvers never read a partial file.
+     *
+     * @param milp The solver of the same problem
+     * @param feasible Result of the solve
+     */
+    void store(CascadeSolver &milp, bool feasible);
+
+    /**
+     * @brief Get the cached selected filters
+     */
+    const std::vector<SelectedFilter> &getSelectedFilters() const override;
+
+    /**
+     * @brief Print the results of the original solver to output stream
+     *
+     * @param out Output stream
+     */
+    void printResults(std::ostream &out = std::cout) override;
+
+private:
+    const std::string m_cacheDirectory;
+    std::string m_problem;
+    std::string m_cachePath;
+    bool m_hit;
+
+    std::vector<SelectedFilter> m_selectedFilters;
+    std::string m_results;
+};
+
+#endif // CACHED_SOLUTION_H
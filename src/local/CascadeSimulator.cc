@@ -0,0 +1,607 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "CascadeSimulator.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <thread>
+
+#include "AsyncWriter.h"
+#include "MappedFile.h"
+#include "SpscQueue.h"
+
+namespace {
+    // Number of samples read from the files at once
+    constexpr std::size_t BlockSize = 1 << 16;
+
+    // Number of outputs accumulated together, to stay in the L1 cache
+    constexpr std::size_t TileSize = 2048;
+
+    // Number of blocks waiting between two threads of the pipeline
+    constexpr std::size_t QueueDepth = 4;
+
+    // Number of samples of a chunk simulated by one thread (without its warm-up)
+    constexpr std::uint64_t ChunkSize = 1 << 22;
+
+    /**
+     * Block of samples going through the pipeline (empty at the end of the file)
+     */
+    struct Block {
+        std::vector<std::int64_t> samples;
+        std::size_t size;
+    };
+
+    /**
+     * Pin the current thread on a core
+     */
+    void pinThread(std::size_t core) {
+#ifdef __linux__
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(core, &cpuSet);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0) {
+            std::cerr << "pinThread: pin on core " << core << ": failed" << std::endl;
+        }
+#else
+        (void)core;
+#endif
+    }
+}
+
+CascadeSimulator::CascadeSimulator(const std::vector<SimulationStage> &stages, const FilterBank *bank)
+: m_selfCheck(false)
+, m_withSpectrum(false)
+, m_fc(0.5) {
+    for (const SimulationStage &stage: stages) {
+        addStage(stage, bank);
+    }
+}
+
+CascadeSimulator::CascadeSimulator(const std::vector<SelectedFilter> &filters, const std::string &coefficientDirectory)
+: m_selfCheck(false)
+, m_withSpectrum(false)
+, m_fc(0.5) {
+    for (const SelectedFilter &filter: filters) {
+        SimulationStage stage = { coefficientDirectory + "/" + filter.filter.getFilterName(), filter.shift, filter.piOut };
+        addStage(stage, nullptr);
+    }
+}
+
+CascadeSimulator::CascadeSimulator(const std::vector<SelectedFilter> &filters, const FilterBank &bank)
+: m_selfCheck(false)
+, m_withSpectrum(false)
+, m_fc(0.5) {
+    for (const SelectedFilter &filter: filters) {
+        SimulationStage stage = { filter.filter.getFilterName(), filter.shift, filter.piOut };
+        addStage(stage, &bank);
+    }
+}
+
+void CascadeSimulator::reset() {
+    for (Stage &stage: m_stages) {
+        stage.history.assign(stage.coeffs.size() - 1, 0);
+        stage.overflows = 0;
+        stage.checkedTiles = 0;
+        std::fill(std::begin(stage.kernelBlocks), std::end(stage.kernelBlocks), 0);
+    }
+    m_spectrum.reset();
+}
+
+void CascadeSimulator::process(const std::int64_t *input, std::int64_t *output, std::size_t size) {
+    std::copy(input, input + size, output);
+
+    for (Stage &stage: m_stages) {
+        processStage(stage, output, size);
+    }
+}
+
+bool CascadeSimulator::simulate(const std::string &inputFile, const std::string &outputFile) {
+    MappedFile input(inputFile);
+    if (!input.isOpen()) {
+        std::cerr << "CascadeSimulator::simulate: open '" << inputFile << "': failed" << std::endl;
+        return false;
+    }
+
+    std::unique_ptr<AsyncWriter> output;
+    if (!outputFile.empty()) {
+        output.reset(new AsyncWriter(outputFile));
+        if (!output->isOpen()) {
+            std::cerr << "CascadeSimulator::simulate: open '" << outputFile << "': failed" << std::endl;
+            return false;
+        }
+    }
+
+    auto tStart = std::chrono::high_resolution_clock::now();
+
+    // Les étages lisent directement le fichier projeté et écrivent dans les buffers du thread d'écriture
+    reset();
+    const std::int64_t *samples = reinterpret_cast<const std::int64_t *>(input.getData());
+    const std::uint64_t nbSample = input.getSize() / sizeof(std::int64_t);
+    const std::size_t bufferSize = output ? output->getBufferSize() : BlockSize;
+    std::vector<std::int64_t> scratch(output ? 0 : bufferSize);
+    std::uint64_t position = 0;
+    while (position < nbSample) {
+        std::int64_t *buffer = output ? output->acquire() : scratch.data();
+        std::size_t filled = 0;
+        while (filled < bufferSize && position < nbSample) {
+            const std::size_t size = std::min<std::uint64_t>({ BlockSize, bufferSize - filled, nbSample - position });
+            process(samples + position, buffer + filled, size);
+            if (m_withSpectrum) {
+                m_spectrum.add(samples + position, buffer + filled, size);
+            }
+            filled += size;
+            position += size;
+        }
+        if (output) {
+            output->commit(buffer, filled);
+        }
+    }
+    const bool success = output ? output->close() : true;
+
+    auto tEnd = std::chrono::high_resolution_clock::now();
+    printReport(nbSample, std::chrono::duration<double>(tEnd-tStart).count());
+
+    return success;
+}
+
+bool CascadeSimulator::simulatePipelined(const std::string &inputFile, const std::string &outputFile, bool pinThreads) {
+    std::ifstream input(inputFile, std::ios::binary);
+    if (input.fail()) {
+        std::cerr << "CascadeSimulator::simulatePipelined: open '" << inputFile << "': failed" << std::endl;
+        return false;
+    }
+
+    std::ofstream output(outputFile, std::ios::binary);
+    if (output.fail()) {
+        std::cerr << "CascadeSimulator::simulatePipelined: open '" << outputFile << "': failed" << std::endl;
+        return false;
+    }
+
+    auto tStart = std::chrono::high_resolution_clock::now();
+
+    reset();
+    const std::size_t nbStage = m_stages.size();
+    const std::size_t nbCore = std::max(1u, std::thread::hardware_concurrency());
+
+    // Lecture -> étage 0 -> ... -> étage N-1 -> écriture, puis retour des blocs libres à la lecture
+    std::vector<Block> blocks(QueueDepth * (nbStage + 2));
+    std::vector< std::unique_ptr< SpscQueue<Block *> > > queues;
+    for (std::size_t s = 0; s <= nbStage; ++s) {
+        queues.emplace_back(new SpscQueue<Block *>(QueueDepth));
+    }
+    SpscQueue<Block *> freeBlocks(blocks.size());
+    for (Block &block: blocks) {
+        block.samples.resize(BlockSize);
+        freeBlocks.push(&block);
+    }
+
+    // Un thread par étage
+    std::vector<std::thread> threads;
+    for (std::size_t s = 0; s < nbStage; ++s) {
+        threads.emplace_back([this, s, nbCore, pinThreads, &queues]() {
+            if (pinThreads) {
+                pinThread((s + 1) % nbCore);
+            }
+
+            for (;;) {
+                Block *block = queues[s]->pop();
+                if (block->size > 0) {
+                    processStage(m_stages[s], block->samples.data(), block->size);
+                }
+                queues[s + 1]->push(block);
+                if (block->size == 0) {
+                    break;
+                }
+            }
+        });
+    }
+
+    // Écriture des blocs filtrés
+    std::uint64_t nbSample = 0;
+    threads.emplace_back([&]() {
+        for (;;) {
+            Block *block = queues[nbStage]->pop();
+            if (block->size == 0) {
+                break;
+            }
+            output.write(reinterpret_cast<const char *>(block->samples.data()), block->size * sizeof(std::int64_t));
+            nbSample += block->size;
+            freeBlocks.push(block);
+        }
+    });
+
+    // Lecture du fichier d'entrée, un bloc vide termine le pipeline
+    for (;;) {
+        Block *block = freeBlocks.pop();
+        input.read(reinterpret_cast<char *>(block->samples.data()), BlockSize * sizeof(std::int64_t));
+        block->size = input.gcount() / sizeof(std::int64_t);
+        queues[0]->push(block);
+        if (block->size == 0) {
+            break;
+        }
+    }
+
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+
+    auto tEnd = std::chrono::high_resolution_clock::now();
+    printReport(nbSample, std::chrono::duration<double>(tEnd-tStart).count());
+
+    return output.good();
+}
+
+bool CascadeSimulator::simulateParallel(const std::string &inputFile, const std::string &outputFile, std::size_t nbThreads) {
+    MappedFile input(inputFile);
+    if (!input.isOpen()) {
+        std::cerr << "CascadeSimulator::simulateParallel: open '" << inputFile << "': failed" << std::endl;
+        return false;
+    }
+    const std::int64_t *samples = reinterpret_cast<const std::int64_t *>(input.getData());
+    const std::uint64_t nbSample = input.getSize() / sizeof(std::int64_t);
+
+    // Le fichier de sortie est créé vide, chaque thread écrit ses chunks à leur position
+    const bool withOutput = !outputFile.empty();
+    if (withOutput) {
+        std::ofstream output(outputFile, std::ios::binary | std::ios::trunc);
+        if (output.fail()) {
+            std::cerr << "CascadeSimulator::simulateParallel: open '" << outputFile << "': failed" << std::endl;
+            return false;
+        }
+    }
+
+    auto tStart = std::chrono::high_resolution_clock::now();
+
+    reset();
+    if (nbThreads == 0) {
+        nbThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const std::uint64_t nbChunk = (nbSample + ChunkSize - 1) / ChunkSize;
+    nbThreads = std::max<std::size_t>(1, std::min<std::uint64_t>(nbThreads, nbChunk));
+
+    // L'échantillon n de la sortie dépend des entrées n - sum(taille_i - 1) à n
+    std::uint64_t warmUp = 0;
+    for (const Stage &stage: m_stages) {
+        warmUp += stage.coeffs.size() - 1;
+    }
+
+    std::atomic<std::uint64_t> nextChunk(0);
+    std::atomic<bool> success(true);
+    std::vector<CascadeSimulator> workers(nbThreads, *this);
+    std::vector<SpectrumAnalyzer> spectra(nbThreads, m_spectrum);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < nbThreads; ++t) {
+        threads.emplace_back([&, t]() {
+            CascadeSimulator &worker = workers[t];
+            std::fstream chunkOutput;
+            if (withOutput) {
+                chunkOutput.open(outputFile, std::ios::binary | std::ios::in | std::ios::out);
+            }
+            if (withOutput && chunkOutput.fail()) {
+                std::cerr << "CascadeSimulator::simulateParallel: open '" << outputFile << "' in a worker: failed" << std::endl;
+                success = false;
+                return;
+            }
+
+            std::vector<std::int64_t> outputBlock(BlockSize);
+
+            for (std::uint64_t chunk = nextChunk++; chunk < nbChunk; chunk = nextChunk++) {
+                const std::uint64_t first = chunk * ChunkSize;
+                const std::uint64_t last = std::min(first + ChunkSize, nbSample);
+
+                // Le chunk est précédé par les échantillons qui remplissent l'historique de tous les étages
+                for (Stage &stage: worker.m_stages) {
+                    stage.history.assign(stage.coeffs.size() - 1, 0);
+                }
+                const std::vector<std::uint64_t> overflows = worker.getOverflows();
+                std::uint64_t position = (first > warmUp) ? first - warmUp : 0;
+                while (position < first) {
+                    const std::size_t size = std::min<std::uint64_t>(BlockSize, first - position);
+                    worker.process(samples + position, outputBlock.data(), size);
+                    position += size;
+                }
+                // Les sorties du préchauffage sont comptées par le chunk précédent
+                for (std::size_t s = 0; s < worker.m_stages.size(); ++s) {
+                    worker.m_stages[s].overflows = overflows[s];
+                }
+
+                // Les chunks sont des multiples de la trame, qui reste alignée sur celles d'une simulation série
+                chunkOutput.seekp(first * sizeof(std::int64_t));
+                while (position < last) {
+                    const std::size_t size = std::min<std::uint64_t>(BlockSize, last - position);
+                    worker.process(samples + position, outputBlock.data(), size);
+                    if (m_withSpectrum) {
+                        spectra[t].add(samples + position, outputBlock.data(), size);
+                    }
+                    if (withOutput) {
+                        chunkOutput.write(reinterpret_cast<const char *>(outputBlock.data()), size * sizeof(std::int64_t));
+                    }
+                    position += size;
+                }
+            }
+
+            if (withOutput && !chunkOutput.good()) {
+                success = false;
+            }
+        });
+    }
+
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+
+    for (std::size_t t = 0; t < nbThreads; ++t) {
+        for (std::size_t s = 0; s < m_stages.size(); ++s) {
+            m_stages[s].overflows += workers[t].m_stages[s].overflows;
+            m_stages[s].checkedTiles += workers[t].m_stages[s].checkedTiles;
+            for (std::size_t k = 0; k < 3; ++k) {
+                m_stages[s].kernelBlocks[k] += workers[t].m_stages[s].kernelBlocks[k];
+            }
+        }
+        m_spectrum.merge(spectra[t]);
+    }
+
+    auto tEnd = std::chrono::high_resolution_clock::now();
+    printReport(nbSample, std::chrono::duration<double>(tEnd-tStart).count());
+
+    return success;
+}
+
+std::vector<std::uint64_t> CascadeSimulator::getOverflows() const {
+    std::vector<std::uint64_t> overflows;
+    for (const Stage &stage: m_stages) {
+        overflows.push_back(stage.overflows);
+    }
+    return overflows;
+}
+
+std::vector<std::uint64_t> CascadeSimulator::getKernelBlocks(std::size_t stage) const {
+    const Stage &current = m_stages[stage];
+    return std::vector<std::uint64_t>(std::begin(current.kernelBlocks), std::end(current.kernelBlocks));
+}
+
+std::size_t CascadeSimulator::getNbCoefficient() const {
+    std::size_t nbCoefficient = 0;
+    for (const Stage &stage: m_stages) {
+        nbCoefficient += stage.coeffs.size();
+    }
+    return nbCoefficient;
+}
+
+void CascadeSimulator::setSpectrum(std::size_t frameSize, double fc) {
+    m_withSpectrum = (frameSize > 0);
+    m_fc = fc;
+    if (m_withSpectrum) {
+        if ((frameSize & (frameSize - 1)) != 0 || ChunkSize % frameSize != 0) {
+            std::cerr << "CascadeSimulator::setSpectrum: The frame size " << frameSize << " is not a power of two smaller than " << ChunkSize << std::endl;
+            std::exit(-1);
+        }
+        m_spectrum = SpectrumAnalyzer(frameSize);
+    }
+}
+
+const SpectrumAnalyzer &CascadeSimulator::getSpectrum() const {
+    return m_spectrum;
+}
+
+void CascadeSimulator::setSelfCheck(bool enabled) {
+    m_selfCheck = enabled;
+}
+
+void CascadeSimulator::addStage(const SimulationStage &description, const FilterBank *bank) {
+    Stage stage;
+    if (bank != nullptr) {
+        // Les coefficients sont lus directement dans l'archive projetée
+        const std::int64_t index = bank->find(description.coefficientFile);
+        if (index < 0) {
+            std::cerr << "CascadeSimulator::addStage: The filter '" << description.coefficientFile << "' is not in the filter bank" << std::endl;
+            std::exit(-1);
+        }
+        const std::int32_t *taps = bank->getTaps(index);
+        stage.coeffs.assign(taps, taps + bank->getEntry(index).cardC);
+    }
+    else {
+        std::ifstream file(description.coefficientFile);
+        if (file.fail()) {
+            std::cerr << "CascadeSimulator::addStage: The coefficient file '" << description.coefficientFile << "' is missing" << std::endl;
+            std::exit(-1);
+        }
+
+        std::int64_t coeff = 0;
+        while (file >> coeff) {
+            stage.coeffs.push_back(coeff);
+        }
+    }
+    if (stage.coeffs.empty()) {
+        std::cerr << "CascadeSimulator::addStage: The coefficient file '" << description.coefficientFile << "' is empty" << std::endl;
+        std::exit(-1);
+    }
+
+    stage.sumAbsCoeffs = 0;
+    for (std::int64_t value: stage.coeffs) {
+        stage.sumAbsCoeffs += std::abs(value);
+        stage.coeffs16.push_back(static_cast<std::int16_t>(value));
+        stage.coeffs32.push_back(static_cast<std::int32_t>(value));
+    }
+    stage.symmetric = std::equal(stage.coeffs.begin(), stage.coeffs.end(), stage.coeffs.rbegin());
+    stage.shift = description.shift;
+    stage.piOut = description.piOut;
+    stage.history.assign(stage.coeffs.size() - 1, 0);
+    stage.overflows = 0;
+    stage.checkedTiles = 0;
+    std::fill(std::begin(stage.kernelBlocks), std::end(stage.kernelBlocks), 0);
+
+    m_stages.push_back(stage);
+}
+
+void CascadeSimulator::processStage(Stage &stage, std::int64_t *samples, std::size_t size) {
+    const std::size_t delay = stage.coeffs.size() - 1;
+
+    // Le bloc courant suit les derniers échantillons du bloc précédent
+    stage.history.resize(delay + size);
+    std::copy(samples, samples + size, stage.history.begin() + delay);
+
+    // Les noyaux étroits lisent aussi les échantillons reportés du bloc précédent
+    std::int64_t maxAbs = 0;
+    for (std::size_t n = 0; n < delay + size; ++n) {
+        maxAbs = std::max(maxAbs, std::abs(stage.history[n]));
+    }
+
+    filterBlock(stage, samples, size, maxAbs);
+
+    // Vérification de la taille de sortie de l'étage
+    const std::int64_t maxOut = (stage.piOut >= 64) ? std::numeric_limits<std::int64_t>::max() : (std::int64_t(1) << (stage.piOut - 1)) - 1;
+    const std::int64_t minOut = -maxOut - 1;
+    std::uint64_t overflows = 0;
+    for (std::size_t n = 0; n < size; ++n) {
+        overflows += (samples[n] < minOut || samples[n] > maxOut);
+    }
+    stage.overflows += overflows;
+
+    std::copy(stage.history.end() - delay, stage.history.end(), stage.history.begin());
+    stage.history.resize(delay);
+}
+
+void CascadeSimulator::printReport(std::uint64_t nbSample, double time) const {
+    std::cout << "Simulated samples: " << nbSample << " (" << time << "s)" << std::endl;
+    const double megabytes = nbSample * sizeof(std::int64_t) / 1e6;
+    std::cout << "Input size: " << megabytes << " MB (" << (time > 0 ? megabytes / time : 0) << " MB/s)" << std::endl;
+    for (std::size_t s = 0; s < m_stages.size(); ++s) {
+        const Stage &stage = m_stages[s];
+        if (m_selfCheck) {
+            std::cout << "Stage #" << s << ": symmetric kernel checked on " << stage.checkedTiles << " tiles" << std::endl;
+            std::cout << "Stage #" << s << ": blocks on int16/int32/int64: " << stage.kernelBlocks[0] << "/" << stage.kernelBlocks[1] << "/" << stage.kernelBlocks[2] << std::endl;
+        }
+        if (stage.overflows > 0) {
+            std::cout << "Stage #" << s << ": " << stage.overflows << " samples exceed " << stage.piOut << " bits" << std::endl;
+        }
+    }
+
+    if (m_withSpectrum && m_spectrum.getNbFrame() > 0) {
+        const SpectrumMeasurement measurement = m_spectrum.measure(m_fc);
+        std::cout << "Measured rejection: " << measurement.rejection << " dB (stopband " << measurement.stopband << " dB, passband ripple " << measurement.ripple << " dB, " << measurement.nbFrame << " frames)" << std::endl;
+    }
+}
+
+void CascadeSimulator::filterBlock(Stage &stage, std::int64_t *output, std::size_t size, std::int64_t maxAbs) {
+    // Un accumulateur de type T ne peut pas déborder si sum(|c|) * max(|x|) <= max(T) (et la pré-addition si 2 * max(|x|) <= max(T)),
+    // x comprenant les échantillons reportés du bloc précédent
+    auto fits = [&stage, maxAbs](std::int64_t maxValue) {
+        return (stage.sumAbsCoeffs <= maxValue) && (maxAbs == 0 || stage.sumAbsCoeffs <= maxValue / maxAbs) && (maxAbs <= maxValue / 2);
+    };
+
+    if (fits(std::numeric_limits<std::int16_t>::max())) {
+        ++stage.kernelBlocks[0];
+        filterNarrow(stage, stage.coeffs16, stage.buffer16, stage.accumulator16, output, size);
+    }
+    else if (fits(std::numeric_limits<std::int32_t>::max())) {
+        ++stage.kernelBlocks[1];
+        filterNarrow(stage, stage.coeffs32, stage.buffer32, stage.accumulator32, output, size);
+    }
+    else {
+        ++stage.kernelBlocks[2];
+        const std::int64_t shift = std::min<std::int64_t>(stage.shift, 63);
+        for (std::size_t start = 0; start < size; start += TileSize) {
+            const std::size_t length = std::min(TileSize, size - start);
+            std::int64_t *acc = output + start;
+            filterTile(stage.coeffs, stage.symmetric, stage.history.data() + start, acc, length, stage.checkedTiles);
+            for (std::size_t n = 0; n < length; ++n) {
+                acc[n] >>= shift;
+            }
+        }
+    }
+}
+
+template <typename T>
+void CascadeSimulator::filterNarrow(Stage &stage, const std::vector<T> &coeffs, std::vector<T> &buffer, std::vector<T> &accumulator, std::int64_t *output, std::size_t size) {
+    const std::int64_t shift = std::min<std::int64_t>(stage.shift, 63);
+    const std::size_t delay = stage.coeffs.size() - 1;
+    buffer.resize(delay + size);
+    accumulator.resize(TileSize);
+    for (std::size_t n = 0; n < delay + size; ++n) {
+        buffer[n] = static_cast<T>(stage.history[n]);
+    }
+
+    for (std::size_t start = 0; start < size; start += TileSize) {
+        const std::size_t length = std::min(TileSize, size - start);
+        T *acc = accumulator.data();
+        filterTile(coeffs, stage.symmetric, buffer.data() + start, acc, length, stage.checkedTiles);
+        for (std::size_t n = 0; n < length; ++n) {
+            output[start + n] = static_cast<std::int64_t>(acc[n]) >> shift;
+        }
+    }
+}
+
+template <typename T>
+void CascadeSimulator::filterTile(const std::vector<T> &coeffs, bool symmetric, const T *input, T *acc, std::size_t length, std::uint64_t &checkedTiles) const {
+    const std::size_t nbTap = coeffs.size();
+    const std::size_t delay = nbTap - 1;
+
+    std::fill(acc, acc + length, 0);
+    if (!symmetric) {
+        for (std::size_t k = 0; k < nbTap; ++k) {
+            const T c = coeffs[k];
+            const T *x = input + delay - k;
+            for (std::size_t n = 0; n < length; ++n) {
+                acc[n] += c * x[n];
+            }
+        }
+        return;
+    }
+
+    // Filtre à phase linéaire : c[k] = c[nbTap - 1 - k], les deux échantillons sont additionnés avant le produit
+    for (std::size_t k = 0; k < nbTap / 2; ++k) {
+        const T c = coeffs[k];
+        const T *xFirst = input + delay - k;
+        const T *xLast = input + k;
+        for (std::size_t n = 0; n < length; ++n) {
+            acc[n] += c * (xFirst[n] + xLast[n]);
+        }
+    }
+    if (nbTap % 2 == 1) {
+        const T c = coeffs[nbTap / 2];
+        const T *x = input + delay / 2;
+        for (std::size_t n = 0; n < length; ++n) {
+            acc[n] += c * x[n];
+        }
+    }
+
+    // Comparaison avec le noyau générique
+    if (m_selfCheck) {
+        std::vector<T> expected(length);
+        filterTile(coeffs, false, input, expected.data(), length, checkedTiles);
+        for (std::size_t n = 0; n < length; ++n) {
+            if (acc[n] != expected[n]) {
+                std::cerr << "CascadeSimulator::filterTile: The symmetric kernel gives " << acc[n] << " instead of " << expected[n] << std::endl;
+                std::exit(-1);
+            }
+        }
+        ++checkedTiles;
+    }
+}
@@ -0,0 +1,263 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef CASCADE_SIMULATOR_H
+#define CASCADE_SIMULATOR_H
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+#include "CascadeSolver.h"
+#include "FilterBank.h"
+#include "SpectrumAnalyzer.h"
+
+/**
+ * @brief Description of one stage of the simulated cascade
+ */
+struct SimulationStage {
+    std::string coefficientFile;    /*!< File with one integer coefficient by line, or filter name in a filter bank */
+    std::int64_t shift;             /*!< Number of bits shifted after the filter */
+    std::int64_t piOut;             /*!< Number of output bits after the shift */
+};
+
+/**
+ * @brief Bit exact simulation of a cascade of integer FIR filters and shifts
+ * The samples are processed by blocks and each stage keeps its last input
+ * samples between two blocks, so a whole capture gives the same output as
+ * a single block. The product of each block is computed on the narrowest
+ * accumulator (int16, int32 or int64) for which the largest input sample and
+ * the sum of the absolute coefficients guarantee that it can not overflow:
+ * the int16 kernels have four times as many SIMD lanes as the int64 ones. The symmetric
+ * filters (linear phase) add the two samples of each pair of identical
+ * coefficients before the product, which halves the number of products. The
+ * kernels are written to be vectorized by the compiler (see LP_NATIVE).
+ */
+class CascadeSimulator {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param stages Stages of the cascade
+     * @param bank Filter bank of the coefficients (null to read the coefficient files)
+     */
+    CascadeSimulator(const std::vector<SimulationStage> &stages, const FilterBank *bank = nullptr);
+
+    /**
+     * @brief Constructor from a solved cascade
+     * The coefficients are read from the file of each filter, relative to the
+     * coefficient directory.
+     *
+     * @param filters Selected filters of the cascade
+     * @param coefficientDirectory Directory of the filters/ coefficient files
+     */
+    CascadeSimulator(const std::vector<SelectedFilter> &filters, const std::string &coefficientDirectory);
+
+    /**
+     * @brief Constructor from a solved cascade and its filter bank
+     *
+     * @param filters Selected filters of the cascade
+     * @param bank Filter bank of the library
+     */
+    CascadeSimulator(const std::vector<SelectedFilter> &filters, const FilterBank &bank);
+
+    /**
+     * @brief Forget the previous samples of all the stages
+     */
+    void reset();
+
+    /**
+     * @brief Filter the next block of samples
+     *
+     * @param input Input samples
+     * @param output Output samples (same size as the input)
+     * @param size Number of samples
+     */
+    void process(const std::int64_t *input, std::int64_t *output, std::size_t size);
+
+    /**
+     * @brief Filter a binary file of int64 samples into another one
+     *
+     * @param inputFile Raw data file
+     * @param outputFile Simulation result file (empty to skip it)
+     * @return false if one of the files can not be opened
+     */
+    bool simulate(const std::string &inputFile, const std::string &outputFile);
+
+    /**
+     * @brief Filter a binary file of int64 samples with one thread by stage
+     * The stages are connected by bounded lock-free queues of blocks: a stage
+     * waits when the next one is late. The file is read and written by two
+     * other threads.
+     *
+     * @param inputFile Raw data file
+     * @param outputFile Simulation result file
+     * @param pinThreads Pin the thread of stage i on core i + 1
+     * @return false if one of the files can not be opened
+     */
+    bool simulatePipelined(const std::string &inputFile, const std::string &outputFile, bool pinThreads);
+
+    /**
+     * @brief Filter a binary file of int64 samples with all the cores
+     * The file is split in chunks simulated independently by a pool of
+     * threads. Each chunk is preceded by as many input samples as the sum of
+     * the delays of the stages, which fill the history of all the stages, so
+     * the output is the same as the one of simulate().
+     *
+     * @param inputFile Raw data file
+     * @param outputFile Simulation result file (empty to skip it)
+     * @param nbThreads Number of threads (0 for the number of cores)
+     * @return false if one of the files can not be opened or read
+     */
+    bool simulateParallel(const std::string &inputFile, const std::string &outputFile, std::size_t nbThreads);
+
+    /**
+     * @brief Get the number of samples of each stage not fitting in its pi_out bits
+     */
+    std::vector<std::uint64_t> getOverflows() const;
+
+    /**
+     * @brief Get the number of blocks of a stage computed on int16, int32 and int64
+     *
+     * @param stage Stage
+     */
+    std::vector<std::uint64_t> getKernelBlocks(std::size_t stage) const;
+
+    /**
+     * @brief Get the number of coefficients of all the stages
+     */
+    std::size_t getNbCoefficient() const;
+
+    /**
+     * @brief Measure the response of the cascade during simulate() and simulateParallel()
+     * The spectra of the input and of the output are averaged online, so the
+     * output file is not needed to check the rejection.
+     *
+     * @param frameSize Number of samples of a frame (power of two, 0 to disable the measure)
+     * @param fc Cutoff frequency of the rejection criterion
+     */
+    void setSpectrum(std::size_t frameSize, double fc);
+
+    /**
+     * @brief Get the response measured by the last simulation
+     */
+    const SpectrumAnalyzer &getSpectrum() const;
+
+    /**
+     * @brief Compare the symmetric kernel to the generic one on each block
+     * The simulation stops on the first difference. It is slower than the
+     * generic kernel alone.
+     *
+     * @param enabled Activate the comparison
+     */
+    void setSelfCheck(bool enabled);
+
+private:
+    /**
+     * @brief Internal state of a stage
+     */
+    struct Stage {
+        std::vector<std::int64_t> coeffs;       /*!< Coefficients */
+        std::vector<std::int16_t> coeffs16;     /*!< Coefficients on 16 bits */
+        std::vector<std::int32_t> coeffs32;     /*!< Coefficients on 32 bits */
+        std::int64_t sumAbsCoeffs;              /*!< Sum of the absolute coefficients */
+        bool symmetric;                         /*!< Indicate if c[k] = c[N - 1 - k] */
+        std::int64_t shift;                     /*!< Number of bits shifted */
+        std::int64_t piOut;                     /*!< Number of output bits */
+        std::vector<std::int64_t> history;      /*!< Last input samples, then the current block */
+        std::vector<std::int16_t> buffer16;     /*!< History and block on 16 bits */
+        std::vector<std::int16_t> accumulator16;/*!< Outputs of a tile on 16 bits */
+        std::vector<std::int32_t> buffer32;     /*!< History and block on 32 bits */
+        std::vector<std::int32_t> accumulator32;/*!< Outputs of a tile on 32 bits */
+        std::uint64_t kernelBlocks[3];          /*!< Number of blocks computed on int16, int32 and int64 */
+        std::uint64_t overflows;                /*!< Number of outputs exceeding pi_out bits */
+        std::uint64_t checkedTiles;             /*!< Number of tiles compared to the generic kernel */
+    };
+
+    /**
+     * @brief Read the coefficients of a stage
+     *
+     * @param stage Description of the stage
+     * @param bank Filter bank of the coefficients (null to read the coefficient file)
+     */
+    void addStage(const SimulationStage &stage, const FilterBank *bank);
+
+    /**
+     * @brief Filter a block of samples by a stage, in place
+     *
+     * @param stage Stage to process
+     * @param samples Input samples, replaced by the output ones
+     * @param size Number of samples
+     */
+    void processStage(Stage &stage, std::int64_t *samples, std::size_t size);
+
+    /**
+     * @brief Print the time and the overflows of the simulation
+     *
+     * @param nbSample Number of simulated samples
+     * @param time Wall clock time
+     */
+    void printReport(std::uint64_t nbSample, double time) const;
+
+    /**
+     * @brief Filter a block of samples by a stage
+     * The input samples must be appended to the history of the stage.
+     *
+     * @param stage Stage to process
+     * @param output Output samples
+     * @param size Number of samples
+     * @param maxAbs Largest absolute sample of the history and the block
+     */
+    void filterBlock(Stage &stage, std::int64_t *output, std::size_t size, std::int64_t maxAbs);
+
+    /**
+     * @brief Filter a block of samples by a stage on a narrow accumulator
+     * The caller guarantees that the accumulator can not overflow.
+     *
+     * @param stage Stage to process
+     * @param coeffs Coefficients of the stage on the accumulator type
+     * @param buffer History and block converted to the accumulator type
+     * @param accumulator Outputs of a tile
+     * @param output Output samples
+     * @param size Number of samples
+     */
+    template <typename T>
+    void filterNarrow(Stage &stage, const std::vector<T> &coeffs, std::vector<T> &buffer, std::vector<T> &accumulator, std::int64_t *output, std::size_t size);
+
+    /**
+     * @brief Accumulate the products of a tile of outputs
+     *
+     * @param coeffs Coefficients
+     * @param symmetric Use the symmetric kernel
+     * @param input First input sample of the tile, preceded by the previous samples
+     * @param acc Outputs of the tile
+     * @param length Number of outputs
+     * @param checkedTiles Counter of the tiles compared to the generic kernel
+     */
+    template <typename T>
+    void filterTile(const std::vector<T> &coeffs, bool symmetric, const T *input, T *acc, std::size_t length, std::uint64_t &checkedTiles) const;
+
+private:
+    std::vector<Stage> m_stages;
+    bool m_selfCheck;
+    bool m_withSpectrum;
+    double m_fc;
+    SpectrumAnalyzer m_spectrum;
+};
+
+#endif // CASCADE_SIMULATOR_H
@@ -0,0 +1,485 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "CascadeSolver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+#include <nlohmann/json.hpp>
+
+#include "FilterBank.h"
+#include "MappedFile.h"
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+namespace {
+    // Same tolerance as the default Gurobi FeasibilityTol
+    constexpr double FeasibilityTol = 1e-6;
+
+    // Rejections closer than this are considered identical
+    constexpr double EquivalenceTol = 1e-9;
+
+    constexpr std::int64_t PiMax = 256;
+
+    /**
+     * Smallest output size of stage i allowed by the constraints on pi_i when
+     * the cumulated rejection is R and the following stages stay empty.
+     */
+    std::int64_t minimalPiOut(const std::int64_t i, const std::int64_t nbStage, const double rejection, bool selected) {
+        // One sign bit per stage and a security bit
+        double bits = rejection / 6.0 + i + 2;
+#ifdef FIX_REJECTION_CONSTRAINT
+        // One more sign bit per previous stage if a filter is selected
+        if (selected) {
+            bits += i + 1;
+        }
+#else
+        (void)selected;
+#endif
+        // The last empty stage needs as many bits
+        bits = std::max(bits, rejection / 6.0 + nbStage + 1);
+
+        return std::ceil(bits - FeasibilityTol);
+    }
+
+    /**
+     * Check the limit, the sizes and the constraints on pi_i of a cascade,
+     * empty stages included.
+     */
+    bool isFeasibleCascade(const std::vector<SelectedFilter> &filters, const std::int64_t nbStage, const std::int64_t piIn, bool maximizeRejection, const double constraintLimit) {
+        double area = 0.0;
+        double rejection = 0.0;
+        for (const SelectedFilter &filter: filters) {
+            area += filter.filter.getCardC() * (filter.filter.getPiC() + filter.piIn);
+            rejection += filter.rejection;
+        }
+
+        bool feasible = (maximizeRejection) ? area <= constraintLimit + FeasibilityTol : rejection >= constraintLimit - FeasibilityTol;
+        double cumulatedRejection = 0.0;
+        std::int64_t pi = piIn;
+        std::size_t index = 0;
+        for (std::int64_t i = 0; i < nbStage && feasible; ++i) {
+            bool selected = index < filters.size() && filters[index].stage == i;
+            if (selected) {
+                const SelectedFilter &filter = filters[index];
+                feasible = filter.piIn == pi && filter.shift >= 0 && filter.shift <= PiMax && filter.piOut <= PiMax;
+                cumulatedRejection += filter.rejection;
+                pi = filter.piOut;
+                ++index;
+            }
+            feasible = feasible && minimalPiOut(i, i + 1, cumulatedRejection, selected) <= pi;
+        }
+
+        // Every filter must be on a stage of the cascade
+        return feasible && index == filters.size();
+    }
+}
+
+CascadeSolver::CascadeSolver(const std::string &experimentName)
+: m_experimentName(experimentName) {
+}
+
+void CascadeSolver::setStart(const std::vector<SelectedFilter> &filters) {
+    // No starting point by default
+    (void)filters;
+}
+
+const std::string &CascadeSolver::getLibraryPath() const {
+    return m_libraryPath;
+}
+
+void CascadeSolver::printDebugFiles(std::ostream &out) {
+    // Nothing to write by default
+    (void)out;
+}
+
+void CascadeSolver::printResults(const std::string &filename) {
+    std::ofstream file(m_experimentName + "/" + filename);
+    if(!file.good()) {
+        std::cerr << "CascadeSolver::printResults(): open '" << m_experimentName << "/" << filename << "': failed" << std::endl;
+        return;
+    }
+
+    printResults(file);
+}
+
+void CascadeSolver::loadFilterLibrary(const std::string &jsonPath) {
+    // Each library is read once and shared by all the solvers of the process
+    static std::mutex cacheMutex;
+    static std::map<std::string, std::vector<Fir>> cache;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    m_libraryPath = jsonPath;
+    auto it = cache.find(jsonPath);
+    if (it != cache.end()) {
+        m_firs = std::vector<Fir>(it->second);
+        return;
+    }
+
+    // Une archive contient toute la bibliothèque, son index est lu sur place
+    if (FilterBank::isFilterBank(jsonPath)) {
+        FilterBank bank(jsonPath);
+        if (!bank.isOpen()) {
+            throw std::runtime_error("CascadeSolver::loadFilterLibrary: The filter bank '" + jsonPath + "' is not valid");
+        }
+
+        m_firs.reserve(bank.getNbFilter());
+        for (std::size_t f = 0; f < bank.getNbFamily(); ++f) {
+            const std::string method = bank.getFamilyName(f);
+            std::size_t first = 0, count = 0;
+            bank.getFamilyRange(f, first, count);
+            for (std::size_t i = first; i < first + count; ++i) {
+                const FilterBank::Entry &entry = bank.getEntry(i);
+                m_firs.emplace_back(method, entry.cardC, entry.piC, entry.rejection);
+            }
+        }
+
+        std::cout << "Total config FIR: " << m_firs.size() << std::endl;
+
+        pruneFilterLibrary();
+
+        cache.emplace(jsonPath, m_firs);
+        return;
+    }
+
+    // Read JSON file to get the filters file loctations
+    std::ifstream jsonFile(jsonPath, std::ios::binary);
+    if (jsonFile.fail()) {
+        throw std::runtime_error("CascadeSolver::loadFilterLibrary: The json file '" + jsonPath + "' is missing");
+    }
+
+    // Get relative path
+    fs::path filtersDirectory = fs::path(jsonPath).parent_path();
+
+    // Create an object json
+    json jsonData;
+    jsonFile >> jsonData;
+
+    // Add all filters
+    for (auto& element : jsonData.items()) {
+        std::string filterPath(filtersDirectory.string() + "/" + static_cast<std::string>(element.value()));
+        loadFirConfiguration(filterPath, element.key());
+    }
+
+    std::cout << "Total config FIR: " << m_firs.size() << std::endl;
+
+    pruneFilterLibrary();
+
+    cache.emplace(jsonPath, m_firs);
+}
+
+void CascadeSolver::pruneFilterLibrary() {
+    const std::size_t nbFirs = m_firs.size();
+
+    // r_i can not be negative, so the filter is never selected
+    std::vector<std::size_t> order;
+    for (std::size_t a = 0; a < nbFirs; ++a) {
+        if (m_firs[a].getNoiseLevel() >= -FeasibilityTol) {
+            order.push_back(a);
+        }
+    }
+
+    // Another filter with the same rejection and the same size can replace it
+    // with less area. The rejection and the size must be identical since both
+    // appear in the constraints on pi_i. The filters are sorted by size and
+    // rejection, so the candidates of a filter are a window of its neighbours.
+    std::sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+        const Fir &firA = m_firs[a];
+        const Fir &firB = m_firs[b];
+        if (firA.getPiC() != firB.getPiC()) {
+            return firA.getPiC() < firB.getPiC();
+        }
+        if (firA.getNoiseLevel() != firB.getNoiseLevel()) {
+            return firA.getNoiseLevel() < firB.getNoiseLevel();
+        }
+        return a < b;
+    });
+
+    // Keep the first of the identical filters
+    auto isBetter = [this](std::size_t a, std::size_t b) {
+        return m_firs[a].getCardC() < m_firs[b].getCardC() || (m_firs[a].getCardC() == m_firs[b].getCardC() && a < b);
+    };
+
+    // A filter is dominated if the best filter of its window is another one.
+    // The window only moves forward: a monotonic deque keeps its best filter.
+    std::vector<bool> dominated(nbFirs, true);
+    std::deque<std::size_t> window;
+    std::size_t next = 0;
+    for (std::size_t k = 0; k < order.size(); ++k) {
+        const Fir &fir = m_firs[order[k]];
+        if (k > 0 && m_firs[order[k - 1]].getPiC() != fir.getPiC()) {
+            window.clear();
+        }
+
+        // Entrée des filtres de rejection <= r + tol de même taille
+        while (next < order.size() && m_firs[order[next]].getPiC() == fir.getPiC() && m_firs[order[next]].getNoiseLevel() - fir.getNoiseLevel() <= EquivalenceTol) {
+            while (!window.empty() && !isBetter(order[window.back()], order[next])) {
+                window.pop_back();
+            }
+            window.push_back(next);
+            ++next;
+        }
+
+        // Sortie des filtres de rejection < r - tol
+        while (!window.empty() && fir.getNoiseLevel() - m_firs[order[window.front()]].getNoiseLevel() > EquivalenceTol) {
+            window.pop_front();
+        }
+
+        dominated[order[k]] = (window.front() != k);
+    }
+
+    std::vector<Fir> firs;
+    for (std::size_t a = 0; a < nbFirs; ++a) {
+        if (!dominated[a]) {
+            firs.push_back(m_firs[a]);
+        }
+    }
+
+    m_firs.swap(firs);
+
+    std::cout << "Pruned config FIR: " << m_firs.size() << " (" << nbFirs - m_firs.size() << " dominated or duplicated)" << std::endl;
+}
+
+std::vector<SelectedFilter> CascadeSolver::buildGreedyCascade(const std::int64_t nbStage, const std::int64_t piIn, bool maximizeRejection, const double constraintLimit) const {
+    // The greedy is cheap: try several shares and keep the best cascade
+    constexpr double ShareFactors[] = { 0.25, 0.5, 0.75, 1.0, 1.5, 2.0 };
+
+    std::vector<SelectedFilter> best;
+    double bestValue = 0.0;
+    for (double shareFactor: ShareFactors) {
+        std::vector<SelectedFilter> filters = buildGreedyCascade(nbStage, piIn, maximizeRejection, constraintLimit, shareFactor);
+        if (filters.empty()) {
+            continue;
+        }
+
+        double value = 0.0;
+        for (const SelectedFilter &filter: filters) {
+            value += (maximizeRejection) ? filter.rejection : filter.filter.getCardC() * (filter.filter.getPiC() + filter.piIn);
+        }
+
+        if (best.empty() || (maximizeRejection && value > bestValue) || (!maximizeRejection && value < bestValue)) {
+            best.swap(filters);
+            bestValue = value;
+        }
+    }
+
+    return best;
+}
+
+std::vector<SelectedFilter> CascadeSolver::buildGreedyCascade(const std::int64_t nbStage, const std::int64_t piIn, bool maximizeRejection, const double constraintLimit, const double shareFactor) const {
+    std::vector<SelectedFilter> filters;
+    double area = 0.0;
+    double rejection = 0.0;
+    std::int64_t pi = piIn;
+
+    for (std::int64_t i = 0; i < nbStage; ++i) {
+        const double remainingStages = nbStage - i;
+        double share = (maximizeRejection) ? (constraintLimit - area) / remainingStages : (constraintLimit - rejection) / remainingStages;
+        share *= shareFactor;
+        if (maximizeRejection) {
+            share = std::min(share, constraintLimit - area);
+        }
+
+        // The rejection min is already reached
+        if (!maximizeRejection && share <= 0.0) {
+            break;
+        }
+
+        std::int64_t best = -1;
+        std::int64_t bestPiOut = 0;
+        double bestArea = 0.0;
+        for (std::size_t j = 0; j < m_firs.size(); ++j) {
+            const Fir &fir = m_firs[j];
+            const double firRejection = fir.getNoiseLevel();
+            const double firArea = fir.getCardC() * (fir.getPiC() + pi);
+            if (firRejection < -FeasibilityTol) {
+                continue;
+            }
+
+            // The output size must be reachable with a shift between 0 and PiMax
+            const std::int64_t piOut = minimalPiOut(i, nbStage, rejection + firRejection, true);
+            if (piOut > pi + fir.getPiFir() || piOut > PiMax || pi + fir.getPiFir() - piOut > PiMax) {
+                continue;
+            }
+
+            bool better = (best < 0);
+            if (maximizeRejection) {
+                if (firArea > share) {
+                    continue;
+                }
+
+                // Most rejection, then least area
+                if (!better) {
+                    const double bestRejection = m_firs[best].getNoiseLevel();
+                    better = firRejection > bestRejection || (firRejection == bestRejection && firArea < bestArea);
+                }
+            }
+            else if (!better) {
+                // Least area among the filters bringing the share, else most rejection
+                const double bestRejection = m_firs[best].getNoiseLevel();
+                const bool enough = firRejection >= share;
+                const bool bestEnough = bestRejection >= share;
+                if (enough != bestEnough) {
+                    better = enough;
+                }
+                else if (enough) {
+                    better = firArea < bestArea || (firArea == bestArea && firRejection > bestRejection);
+                }
+                else {
+                    better = firRejection > bestRejection || (firRejection == bestRejection && firArea < bestArea);
+                }
+            }
+
+            if (better) {
+                best = j;
+                bestPiOut = piOut;
+                bestArea = firArea;
+            }
+        }
+
+        // The stage stays empty
+        if (best < 0) {
+            continue;
+        }
+
+        const Fir &fir = m_firs[best];
+        SelectedFilter filter = { i, fir, fir.getNoiseLevel(), pi + fir.getPiFir() - bestPiOut, pi, fir.getPiFir(), bestPiOut };
+        filters.emplace_back(filter);
+
+        area += bestArea;
+        rejection += fir.getNoiseLevel();
+        pi = bestPiOut;
+    }
+
+    // Check the whole cascade, empty stages included
+    if (!isFeasibleCascade(filters, nbStage, piIn, maximizeRejection, constraintLimit)) {
+        filters.clear();
+    }
+
+    return filters;
+}
+
+std::vector<SelectedFilter> CascadeSolver::adaptCascade(const std::vector<SelectedFilter> &filters, const std::int64_t nbStage, const std::int64_t piIn, bool maximizeRejection, const double constraintLimit) const {
+    std::vector<SelectedFilter> adapted;
+    for (const SelectedFilter &filter: filters) {
+        if (filter.stage < nbStage) {
+            adapted.push_back(filter);
+        }
+    }
+
+    // The stages after the last filter stay empty and need its output size
+    if (!adapted.empty()) {
+        double rejection = 0.0;
+        for (const SelectedFilter &filter: adapted) {
+            rejection += filter.rejection;
+        }
+
+        // The missing bits are taken from the shift of the last filters
+        const SelectedFilter &last = adapted.back();
+        std::int64_t missing = minimalPiOut(last.stage, nbStage, rejection, true) - last.piOut;
+        for (auto it = adapted.rbegin(); it != adapted.rend() && missing > 0; ++it) {
+            const std::int64_t kept = std::min(missing, it->shift);
+            it->shift -= kept;
+            missing -= kept;
+        }
+
+        std::int64_t pi = piIn;
+        for (SelectedFilter &filter: adapted) {
+            filter.piIn = pi;
+            filter.piOut = pi + filter.piFir - filter.shift;
+            pi = filter.piOut;
+        }
+    }
+
+    if (!isFeasibleCascade(adapted, nbStage, piIn, maximizeRejection, constraintLimit)) {
+        adapted.clear();
+    }
+
+    return adapted;
+}
+
+void CascadeSolver::setGreedyStart(const std::int64_t nbStage, const std::int64_t piIn, bool maximizeRejection, const double constraintLimit) {
+    auto tStart = std::chrono::high_resolution_clock::now();
+
+    std::vector<SelectedFilter> filters = buildGreedyCascade(nbStage, piIn, maximizeRejection, constraintLimit);
+
+    auto tEnd = std::chrono::high_resolution_clock::now();
+    double time = std::chrono::duration<double>(tEnd-tStart).count();
+
+    if (filters.empty()) {
+        std::cout << "Greedy start: no feasible cascade (" << time << "s)" << std::endl;
+        return;
+    }
+
+    double area = 0.0;
+    double rejection = 0.0;
+    for (const SelectedFilter &filter: filters) {
+        area += filter.filter.getCardC() * (filter.filter.getPiC() + filter.piIn);
+        rejection += filter.rejection;
+    }
+    std::cout << "Greedy start: area = " << area << ", rejection = " << rejection << " (" << time << "s)" << std::endl;
+
+    setStart(filters);
+}
+
+std::int64_t CascadeSolver::findFir(const Fir &fir) const {
+    for (std::size_t j = 0; j < m_firs.size(); ++j) {
+        if (m_firs[j].getFilterName() == fir.getFilterName() && m_firs[j].getNoiseLevel() == fir.getNoiseLevel()) {
+            return j;
+        }
+    }
+
+    return -1;
+}
+
+void CascadeSolver::loadFirConfiguration(const std::string &filename, const std::string &method) {
+    // Open the file
+    MappedFile file(filename);
+    if (!file.isOpen()) {
+        throw std::runtime_error("CascadeSolver::loadFirConfiguration: The file '" + filename + "' is missing");
+    }
+
+    // Read all the complete records
+    constexpr std::size_t RecordSize = 2 * sizeof(std::uint16_t) + sizeof(double);
+    const std::size_t nbRecord = file.getSize() / RecordSize;
+    m_firs.reserve(m_firs.size() + nbRecord);
+    for (std::size_t i = 0; i < nbRecord; ++i) {
+        const char *record = file.getData() + i * RecordSize;
+        std::uint16_t nob = 0;
+        std::uint16_t coeff = 0;
+        double rejection = 0.0;
+
+        // Read the values
+        std::memcpy(&nob, record, sizeof(std::uint16_t));
+        std::memcpy(&coeff, record + sizeof(std::uint16_t), sizeof(std::uint16_t));
+        std::memcpy(&rejection, record + 2 * sizeof(std::uint16_t), sizeof(double));
+
+        // Add fir configuration
+        m_firs.emplace_back(method, coeff, nob, rejection);
+    }
+}
@@ -0,0 +1,216 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef CASCADE_SOLVER_H
+#define CASCADE_SOLVER_H
+
+#include <cinttypes>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Fir.h"
+
+/**
+ * @brief Structure to handle the filter selection
+ *
+ * @see Fir
+ */
+struct SelectedFilter {
+    std::int64_t stage;     /*!< Indicate the stage  */
+    Fir filter;             /*!< Describe the selected filter */
+    double rejection;       /*!< Indicate the total rejection */
+    std::int64_t shift;     /*!< Indicate the number of shited bits */
+    std::int64_t piIn;      /*!< Indicate the number of input bits */
+    std::int64_t piFir;     /*!< Indicate the number of bits added by the filter */
+    std::int64_t piOut;     /*!< Indicate the number of output bits */
+};
+
+/**
+ * @brief Interface of any solver choosing a cascade of filters
+ *
+ * @see QuadraticProgram
+ * @see DynamicProgram
+ */
+class CascadeSolver {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param experimentName Name used to create some folders and files
+     */
+    CascadeSolver(const std::string &experimentName);
+
+    /**
+     * @brief Default destructor
+     */
+    virtual ~CascadeSolver() {}
+
+    /**
+     * @brief Solve the problem
+     *
+     * @return true if a cascade was found
+     */
+    virtual bool solve() = 0;
+
+    /**
+     * @brief Give a known cascade as starting point of the next solve
+     * The stages of the filters must exist in the problem. By default, the
+     * starting point is ignored.
+     *
+     * @param filters Selected filters of the known cascade
+     */
+    virtual void setStart(const std::vector<SelectedFilter> &filters);
+
+    /**
+     * @brief Get the selected filters
+     */
+    virtual const std::vector<SelectedFilter>& getSelectedFilters() const = 0;
+
+    /**
+     * @brief Get the path of the filter library (JSON file or filter bank)
+     */
+    const std::string &getLibraryPath() const;
+
+    /**
+     * @brief Print the debug files
+     *
+     * @param out Output stream
+     */
+    virtual void printDebugFiles(std::ostream &out = std::cout);
+
+    /**
+     * @brief Print the result files
+     *
+     * @param out Output stream
+     */
+    virtual void printResults(std::ostream &out = std::cout) = 0;
+
+    /**
+     * @brief Print the result into indicate file
+     *
+     * @param filename Path of output file
+     */
+    void printResults(const std::string &filename);
+
+protected:
+    /**
+     * @brief Load all the FIR configurations listed in a JSON file
+     * The JSON file associates each generation method to a binary file
+     * relative to the JSON file location. The path can also be a filter bank
+     * archive, whose index is read in place. Each library is read once by
+     * process, the next solvers get a copy of the same library.
+     *
+     * @param jsonPath Path to the JSON file or to the filter bank
+     * @throw std::runtime_error if a file of the library is missing or not valid
+     */
+    void loadFilterLibrary(const std::string &jsonPath);
+
+    /**
+     * @brief Remove the filters which can not change the optimum
+     * A filter is removed if it can never be selected (negative rejection) or
+     * if another filter with the same rejection and the same size uses fewer
+     * coefficients. Identical filters are kept only once.
+     */
+    void pruneFilterLibrary();
+
+    /**
+     * @brief Build a feasible cascade with a greedy heuristic
+     * Stage after stage, the filter with the most rejection fitting in its
+     * share of the remaining area is selected (maximize rejection), or the
+     * cheapest filter bringing its share of the missing rejection (minimize
+     * area). Each output size is the smallest one meeting the constraints on
+     * pi_i, including those of the following stages if they stay empty.
+     * Several shares are tried and the best cascade is kept.
+     *
+     * @param nbStage Total stage
+     * @param piIn Input size of the first stage
+     * @param maximizeRejection Criterion to optimize
+     * @param constraintLimit Area max or rejection min according to the criterion
+     * @return Selected filters, empty if no feasible cascade was found
+     */
+    std::vector<SelectedFilter> buildGreedyCascade(const std::int64_t nbStage, const std::int64_t piIn, bool maximizeRejection, const double constraintLimit) const;
+
+    /**
+     * @brief Build a greedy cascade with a given share of the remaining budget
+     *
+     * @param nbStage Total stage
+     * @param piIn Input size of the first stage
+     * @param maximizeRejection Criterion to optimize
+     * @param constraintLimit Area max or rejection min according to the criterion
+     * @param shareFactor Factor applied to the even share of the remaining budget
+     * @return Selected filters, empty if no feasible cascade was found
+     */
+    std::vector<SelectedFilter> buildGreedyCascade(const std::int64_t nbStage, const std::int64_t piIn, bool maximizeRejection, const double constraintLimit, const double shareFactor) const;
+
+    /**
+     * @brief Adapt a known cascade to a number of stages
+     * The filters keep their stage. The stages after the last filter stay
+     * empty, so the output size of the last filter is raised to the smallest
+     * one meeting their constraints on pi_i, as in buildGreedyCascade(). The
+     * missing bits are taken from the shifts of the last filters, starting
+     * with the last one.
+     *
+     * @param filters Selected filters of the known cascade
+     * @param nbStage Total stage
+     * @param piIn Input size of the first stage
+     * @param maximizeRejection Criterion to optimize
+     * @param constraintLimit Area max or rejection min according to the criterion
+     * @return Adapted filters, empty if the cascade is not feasible with nbStage stages
+     */
+    std::vector<SelectedFilter> adaptCascade(const std::vector<SelectedFilter> &filters, const std::int64_t nbStage, const std::int64_t piIn, bool maximizeRejection, const double constraintLimit) const;
+
+    /**
+     * @brief Use the greedy cascade as starting point and log its value
+     *
+     * @param nbStage Total stage
+     * @param piIn Input size of the first stage
+     * @param maximizeRejection Criterion to optimize
+     * @param constraintLimit Area max or rejection min according to the criterion
+     */
+    void setGreedyStart(const std::int64_t nbStage, const std::int64_t piIn, bool maximizeRejection, const double constraintLimit);
+
+    /**
+     * @brief Get the index of a filter in the library
+     *
+     * @param fir Filter to find
+     * @return Index of the filter or -1 if it is missing
+     */
+    std::int64_t findFir(const Fir &fir) const;
+
+    /**
+     * @brief Load FIR confiuration form binary file
+     * The format of binary file is :
+     * 1) uint16 (number of coefficients)
+     * 2) uint16 (number of bit for each coefficient)
+     * 3) double (noise rejection)
+     *
+     * @param filename Binary filename
+     * @param method Algorithm used to create the coefficients
+     * @throw std::runtime_error if the file is missing
+     */
+    void loadFirConfiguration(const std::string &filename, const std::string &method);
+
+protected:
+    const std::string m_experimentName;   /*!< Experiment name used to create directory and files */
+
+    std::vector<Fir> m_firs;              /*!< Storage for all filter configurations */
+    std::string m_libraryPath;            /*!< Path of the loaded filter library */
+};
+
+#endif // CASCADE_SOLVER_H
@@ -0,0 +1,49 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "CascadeVerifier.h"
+
+CascadeVerifier::CascadeVerifier(const std::string &libraryPath, const std::string &responseCachePath, double fc)
+: m_bank(libraryPath)
+, m_cache(responseCachePath)
+, m_fc(fc) {
+}
+
+bool CascadeVerifier::isOpen() const {
+    return m_bank.isOpen() && m_cache.isOpen();
+}
+
+bool CascadeVerifier::measure(const std::vector<Fir> &filters, double &rejection) const {
+    std::vector< std::vector<std::int64_t> > stages;
+    for (const Fir &fir: filters) {
+        const std::int64_t index = m_bank.find(fir.getFilterName());
+        if (index < 0) {
+            return false;
+        }
+        const std::int32_t *taps = m_bank.getTaps(index);
+        stages.emplace_back(taps, taps + m_bank.getEntry(index).cardC);
+    }
+
+    std::vector<float> response;
+    if (!m_cache.getCascadeResponse(stages, response)) {
+        return false;
+    }
+    rejection = ResponseCache::measureRejection(response, m_fc);
+
+    return true;
+}
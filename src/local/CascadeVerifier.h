@@ -0,0 +1,67 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef CASCADE_VERIFIER_H
+#define CASCADE_VERIFIER_H
+
+#include <string>
+#include <vector>
+
+#include "FilterBank.h"
+#include "Fir.h"
+#include "ResponseCache.h"
+
+/**
+ * @brief Rejection of a cascade computed from the response of its quantized coefficients
+ * The solvers score a cascade by the sum of the rejections of its filters;
+ * the verifier adds the responses of the quantized coefficients of the
+ * stages (read in the filter bank, then in the response cache) and applies
+ * the rejection criterion of the library to the response of the cascade.
+ */
+class CascadeVerifier {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param libraryPath Filter bank of the filter library
+     * @param responseCachePath Response cache of the filters of the bank
+     * @param fc Cutoff frequency of the rejection criterion
+     */
+    CascadeVerifier(const std::string &libraryPath, const std::string &responseCachePath, double fc = 0.5);
+
+    /**
+     * @brief Check if the filter bank and the response cache could be opened
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Compute the rejection of a cascade
+     *
+     * @param filters Filters of the stages
+     * @param rejection Rejection of the response of the cascade (dB)
+     * @return false if a filter is not in the filter bank or in the response cache
+     */
+    bool measure(const std::vector<Fir> &filters, double &rejection) const;
+
+private:
+    FilterBank m_bank;
+    ResponseCache m_cache;
+    double m_fc;
+};
+
+#endif // CASCADE_VERIFIER_H
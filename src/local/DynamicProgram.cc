@@ -0,0 +1,466 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "DynamicProgram.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <map>
+
+namespace {
+    constexpr std::int64_t PiIn = 16; // PRN input
+    // constexpr std::int64_t PiIn = 7; // ADC input
+    constexpr std::int64_t PiMax = 256;
+
+    // Same tolerance as the default Gurobi FeasibilityTol
+    constexpr double FeasibilityTol = 1e-6;
+
+    // Number of tails kept by state to find the first cascade
+    constexpr std::size_t BeamWidth = 8;
+}
+
+DynamicProgram::DynamicProgram(Mode mode, const std::int64_t nbStage, const double constraintLimit, const std::string &jsonPath, const std::string &experimentName)
+: CascadeSolver(experimentName)
+, m_mode(mode)
+, m_nbStage(nbStage)
+, m_constraintLimit(constraintLimit)
+, m_incumbent((mode == Mode::MaximizeRejection) ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity())
+, m_cascade({ 0, 0.0, PiIn, {}, {} })
+, m_objectiveValue(0.0)
+, m_computationTime(0.0) {
+    // Load all the filter configurations
+    loadFilterLibrary(jsonPath);
+}
+
+bool DynamicProgram::solve() {
+    auto tStart = std::chrono::high_resolution_clock::now();
+
+    bool feasible = false;
+    m_paretoFront.clear();
+    m_incumbent = (m_mode == Mode::MaximizeRejection) ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+
+    if (m_mode == Mode::ParetoFront) {
+        solveStates(0);
+        buildParetoFront();
+
+        feasible = !m_paretoFront.empty();
+    }
+    else {
+        // A first pass keeping only a few tails per state quickly finds a good
+        // cascade, its value then bounds the exact pass
+        solveStates(BeamWidth);
+        std::size_t best = selectBestLabel();
+        if (best < m_states[0][PiIn].size()) {
+            const Label &label = m_states[0][PiIn][best];
+            m_incumbent = (m_mode == Mode::MaximizeRejection) ? label.rejection : label.area;
+        }
+
+        solveStates(0);
+        best = selectBestLabel();
+
+        feasible = best < m_states[0][PiIn].size();
+        if (feasible) {
+            m_cascade = rebuildCascade(best);
+        }
+    }
+
+    auto tEnd = std::chrono::high_resolution_clock::now();
+
+    m_computationTime = std::chrono::duration<double>(tEnd-tStart).count();
+    std::cout << "Wall clock time passed: " << m_computationTime << "s" << std::endl;
+
+    if (!feasible) {
+        return false;
+    }
+
+    m_objectiveValue = (m_mode == Mode::MinimizeArea) ? m_cascade.area : m_cascade.rejection;
+
+    return true;
+}
+
+const std::vector<SelectedFilter> &DynamicProgram::getSelectedFilters() const {
+    return m_cascade.filters;
+}
+
+const std::vector<DynamicProgram::Cascade> &DynamicProgram::getParetoFront() const {
+    return m_paretoFront;
+}
+
+void DynamicProgram::printResults(std::ostream &out) {
+    out << std::endl;
+    out << "Computation Time = " << m_computationTime << " seconds" << std::endl;
+
+    if (m_mode == Mode::ParetoFront) {
+        out << std::endl;
+        out << "### Pareto front ###" << std::endl;
+        out << "Non dominated cascades = " << m_paretoFront.size() << std::endl;
+
+        for (std::size_t point = 0; point < m_paretoFront.size(); ++point) {
+            const Cascade &cascade = m_paretoFront[point];
+            out << std::endl;
+            out << "### Point #" << point << " ###" << std::endl;
+            out << "Area = " << cascade.area << std::endl;
+            out << "Rejection = " << cascade.rejection << std::endl;
+            out << "Last pi_i = " << cascade.lastPi << std::endl;
+            printCascade(cascade, out);
+        }
+        return;
+    }
+
+    out << std::endl;
+    out << "### Main criteria ###" << std::endl;
+    out << "Objectif = " << m_objectiveValue << std::endl;
+    out << "Area = " << m_cascade.area << std::endl;
+    out << "Rejection = " << m_cascade.rejection << std::endl;
+    out << "Last pi_i = " << m_cascade.lastPi << std::endl;
+    printCascade(m_cascade, out);
+}
+
+void DynamicProgram::printCascade(const Cascade &cascade, std::ostream &out) {
+    out << std::endl;
+    out << "### Selected filters ###" << std::endl;
+    int i = 0;
+    for (const SelectedFilter &filter: cascade.filters) {
+        out << "Stage #" << filter.stage << std::endl;
+        out << filter.filter << std::endl;
+        out << "pi_in: " << filter.piIn << std::endl;
+        out << "pi_fir: " << filter.piFir << std::endl;
+        out << "pi_out: " << filter.piOut << std::endl;
+        out << "r_i: " << filter.rejection << std::endl;
+        out << "r_i/6: " << filter.rejection / 6.0 << std::endl;
+        out << "With shift: " << filter.shift << std::endl;
+        out << "Stage rejection: " << cascade.stageRejections[i] << std::endl;
+        ++i;
+    }
+
+    out << std::endl;
+    out << "### Command for the C++ simulator" << std::endl;
+    out << "./cascaded-filters data_prn.bin simu_stage.bin ";
+    for (const SelectedFilter &filter: cascade.filters) {
+        out << filter.filter.getFilterName() << " " << filter.shift << " " << filter.piOut << " ";
+    }
+    out << std::endl;
+}
+
+void DynamicProgram::keepNonDominated(std::vector<Label> &labels) {
+    // Sort by area, the best label first on equality
+    std::sort(labels.begin(), labels.end(), [](const Label &lhs, const Label &rhs) {
+        if (lhs.area != rhs.area) {
+            return lhs.area < rhs.area;
+        }
+        if (lhs.rejection != rhs.rejection) {
+            return lhs.rejection > rhs.rejection;
+        }
+        return lhs.headroom > rhs.headroom;
+    });
+
+    // Staircase of the kept labels: the headroom decreases when the rejection increases
+    std::map<double, double> staircase;
+    std::size_t kept = 0;
+    for (const Label &label: labels) {
+        // A kept label with a lower area, more rejection and more headroom dominates it
+        auto it = staircase.lower_bound(label.rejection);
+        if (it != staircase.end() && it->second >= label.headroom) {
+            continue;
+        }
+
+        // Remove the steps now dominated
+        it = staircase.upper_bound(label.rejection);
+        while (it != staircase.begin() && std::prev(it)->second <= label.headroom) {
+            staircase.erase(std::prev(it));
+        }
+        staircase.emplace(label.rejection, label.headroom);
+
+        labels[kept] = label;
+        ++kept;
+    }
+    labels.resize(kept);
+}
+
+std::size_t DynamicProgram::selectBestLabel() const {
+    const std::vector<Label> &labels = m_states[0][PiIn];
+    std::size_t best = labels.size();
+    for (std::size_t index = 0; index < labels.size(); ++index) {
+        const Label &label = labels[index];
+
+        if (m_mode == Mode::MinimizeArea && label.rejection < m_constraintLimit - FeasibilityTol) {
+            continue;
+        }
+
+        if (best == labels.size()) {
+            best = index;
+            continue;
+        }
+
+        const Label &incumbent = labels[best];
+        if (m_mode == Mode::MaximizeRejection) {
+            if (label.rejection > incumbent.rejection || (label.rejection == incumbent.rejection && label.area < incumbent.area)) {
+                best = index;
+            }
+        }
+        else {
+            if (label.area < incumbent.area || (label.area == incumbent.area && label.rejection > incumbent.rejection)) {
+                best = index;
+            }
+        }
+    }
+
+    return best;
+}
+
+void DynamicProgram::solveStates(std::size_t beamWidth) {
+    const std::int64_t NbStage = m_nbStage;
+
+    // A tail is kept only if it can lead to a better cascade than the incumbent
+    double areaBound = m_incumbent;
+    double rejectionBound = m_constraintLimit;
+    if (m_mode == Mode::MaximizeRejection) {
+        areaBound = m_constraintLimit;
+        rejectionBound = m_incumbent;
+    }
+    else if (m_mode == Mode::ParetoFront) {
+        areaBound = std::numeric_limits<double>::infinity();
+        rejectionBound = -std::numeric_limits<double>::infinity();
+    }
+
+    // More rejection than the rejection min is useless
+    const double UsefulRejection = (m_mode == Mode::MinimizeArea) ? m_constraintLimit : std::numeric_limits<double>::infinity();
+
+    // Largest input size reachable at each stage
+    std::int64_t maxPiFir = 0;
+    double maxRejection = 0.0;
+    for (const Fir &fir: m_firs) {
+        maxPiFir = std::max(maxPiFir, fir.getPiFir());
+        maxRejection = std::max(maxRejection, fir.getNoiseLevel());
+    }
+    std::vector<std::int64_t> maxPi(NbStage + 1, PiIn);
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        maxPi[i + 1] = std::min(PiMax, maxPi[i] + maxPiFir);
+    }
+
+    // Lower bound of the area used by the previous stages to reach an input size
+    // (the constraints on the output sizes are relaxed)
+    std::vector< std::vector<double> > minPreviousArea(NbStage + 1, std::vector<double>(PiMax + 1, std::numeric_limits<double>::infinity()));
+    minPreviousArea[0][PiIn] = 0.0;
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        std::vector<double> &nextArea = minPreviousArea[i + 1];
+        for (std::int64_t piIn = 0; piIn <= maxPi[i]; ++piIn) {
+            const double previousArea = minPreviousArea[i][piIn];
+            nextArea[piIn] = std::min(nextArea[piIn], previousArea);
+            for (const Fir &fir: m_firs) {
+                const std::int64_t maxPiOut = std::min(PiMax, piIn + fir.getPiFir());
+                nextArea[maxPiOut] = std::min(nextArea[maxPiOut], previousArea + fir.getCardC() * (fir.getPiC() + piIn));
+            }
+        }
+
+        // A bigger output size can always be shifted
+        for (std::int64_t pi = PiMax - 1; pi >= 0; --pi) {
+            nextArea[pi] = std::min(nextArea[pi], nextArea[pi + 1]);
+        }
+    }
+
+    // The tail after the last stage is empty
+    m_states.assign(NbStage + 1, std::vector< std::vector<Label> >(PiMax + 1));
+    for (std::int64_t pi = 0; pi <= maxPi[NbStage]; ++pi) {
+        Label label = { 0, 0.0, std::numeric_limits<double>::infinity(), -1, static_cast<std::int32_t>(pi), -1 };
+        m_states[NbStage][pi].push_back(label);
+    }
+
+    std::size_t nbLabels = 0;
+    for (std::int64_t i = NbStage - 1; i >= 0; --i) {
+        // Bits reserved on pi_i: one sign bit per stage and a security bit
+        const std::int64_t emptyReservedBits = i + 2;
+#ifdef FIX_REJECTION_CONSTRAINT
+        // One more sign bit per previous stage if a filter is selected
+        const std::int64_t firReservedBits = emptyReservedBits + i + 1;
+#else
+        const std::int64_t firReservedBits = emptyReservedBits;
+#endif
+
+        // Add the constraint on pi_i to the tails starting at stage i + 1
+        auto addTails = [&](std::int64_t pi, std::int64_t reservedBits, std::vector<Label> &labels) {
+            const std::vector<Label> &tails = m_states[i + 1][pi];
+            for (std::size_t index = 0; index < tails.size(); ++index) {
+                const Label &tail = tails[index];
+                double headroom = std::min(tail.headroom, 6.0 * (pi - reservedBits));
+                if (headroom < -FeasibilityTol) {
+                    continue;
+                }
+
+                Label label = { tail.area, tail.rejection, headroom, -1, static_cast<std::int32_t>(pi), static_cast<std::int32_t>(index) };
+                labels.push_back(label);
+            }
+        };
+
+        // All the tails reachable with an output size lower or equal to pi
+        std::vector< std::vector<Label> > cumulativeTails(maxPi[i + 1] + 1);
+        std::vector<Label> tails;
+        for (std::int64_t pi = 0; pi <= maxPi[i + 1]; ++pi) {
+            addTails(pi, firReservedBits, tails);
+            keepNonDominated(tails);
+            cumulativeTails[pi] = tails;
+        }
+
+        const std::int64_t minPiIn = (i == 0) ? PiIn : 0;
+        for (std::int64_t piIn = minPiIn; piIn <= maxPi[i]; ++piIn) {
+            // The previous stages can not reach more rejection than their
+            // own constraint on pi_(i-1) allows, so any extra headroom is useless
+            const double maxHeadroom = (i == 0) ? 0.0 : std::min(6.0 * (piIn - i - 1), i * maxRejection);
+            const double maxArea = areaBound - minPreviousArea[i][piIn];
+            if (maxHeadroom < -FeasibilityTol || maxArea < 0.0) {
+                continue;
+            }
+
+            std::vector<Label> labels;
+            auto addLabel = [&](Label label) {
+                label.headroom = std::min(label.headroom, maxHeadroom);
+                label.rejection = std::min(label.rejection, UsefulRejection);
+
+                // Even the best previous stages can not reach the bound
+                if (label.headroom < -FeasibilityTol || label.rejection + label.headroom < rejectionBound - FeasibilityTol) {
+                    return;
+                }
+                labels.push_back(label);
+            };
+
+            // Empty stage: the size is unchanged
+            std::vector<Label> emptyTails;
+            addTails(piIn, emptyReservedBits, emptyTails);
+            for (const Label &tail: emptyTails) {
+                if (tail.area > maxArea) {
+                    break;
+                }
+                addLabel(tail);
+            }
+
+            for (std::size_t j = 0; j < m_firs.size(); ++j) {
+                const Fir &fir = m_firs[j];
+
+                // r_i can not be negative
+                const double rejection = fir.getNoiseLevel();
+                if (rejection < -FeasibilityTol) {
+                    continue;
+                }
+
+                const std::int64_t area = fir.getCardC() * (fir.getPiC() + piIn);
+                if (area > maxArea) {
+                    continue;
+                }
+
+                // The output size depends on the shift (0 <= pi_s <= PiMax)
+                const std::int64_t maxPiOut = std::min(PiMax, piIn + fir.getPiFir());
+                const std::int64_t minPiOut = piIn + fir.getPiFir() - PiMax;
+                const std::vector<Label> *fromTails = &cumulativeTails[maxPiOut];
+                std::vector<Label> rangeTails;
+                if (minPiOut > 0) {
+                    for (std::int64_t pi = minPiOut; pi <= maxPiOut; ++pi) {
+                        addTails(pi, firReservedBits, rangeTails);
+                    }
+                    keepNonDominated(rangeTails);
+                    fromTails = &rangeTails;
+                }
+
+                // The tails are sorted by area
+                for (const Label &tail: *fromTails) {
+                    if (tail.area + area > maxArea) {
+                        break;
+                    }
+
+                    Label label = { tail.area + area, tail.rejection + rejection, tail.headroom - rejection, static_cast<std::int32_t>(j), tail.width, tail.next };
+                    addLabel(label);
+                }
+            }
+
+            keepNonDominated(labels);
+
+            // Keep only the most promising tails
+            if (beamWidth > 0 && labels.size() > beamWidth) {
+                auto promising = [this](const Label &lhs, const Label &rhs) {
+                    if (m_mode == Mode::MaximizeRejection) {
+                        return lhs.rejection + lhs.headroom > rhs.rejection + rhs.headroom;
+                    }
+                    return lhs.area < rhs.area;
+                };
+                std::nth_element(labels.begin(), labels.begin() + beamWidth, labels.end(), promising);
+                labels.resize(beamWidth);
+                keepNonDominated(labels);
+            }
+
+            nbLabels += labels.size();
+            m_states[i][piIn] = std::move(labels);
+        }
+    }
+
+    if (beamWidth == 0) {
+        std::cout << "Dynamic program: " << nbLabels << " non dominated tails" << std::endl;
+    }
+}
+
+void DynamicProgram::buildParetoFront() {
+    // The feasible labels of the first state are sorted by area, so the
+    // rejection must strictly increase along the front
+    const std::vector<Label> &labels = m_states[0][PiIn];
+    double bestRejection = -std::numeric_limits<double>::infinity();
+    std::size_t best = labels.size();
+    for (std::size_t index = 0; index < labels.size(); ++index) {
+        if (labels[index].rejection <= bestRejection) {
+            continue;
+        }
+
+        bestRejection = labels[index].rejection;
+        best = index;
+        m_paretoFront.push_back(rebuildCascade(index));
+    }
+
+    // The selected filters are those of the best rejection
+    if (best < labels.size()) {
+        m_cascade = rebuildCascade(best);
+    }
+
+    std::cout << "Pareto front: " << m_paretoFront.size() << " non dominated cascades" << std::endl;
+}
+
+DynamicProgram::Cascade DynamicProgram::rebuildCascade(std::size_t index) const {
+    Cascade cascade = { 0, 0.0, PiIn, {}, std::vector<double>(m_nbStage, 0.0) };
+
+    std::int64_t pi = PiIn;
+    const Label *label = &m_states[0][PiIn][index];
+    for (std::int64_t i = 0; i < m_nbStage; ++i) {
+        if (label->fir >= 0) {
+            const Fir &fir = m_firs[label->fir];
+            double rejection = fir.getNoiseLevel();
+            std::int64_t shift = pi + fir.getPiFir() - label->width;
+
+            SelectedFilter filter = { i, fir, rejection, shift, pi, fir.getPiFir(), label->width };
+            cascade.filters.emplace_back(filter);
+
+            cascade.stageRejections[i] = rejection;
+            cascade.area += fir.getCardC() * (fir.getPiC() + pi);
+            cascade.rejection += rejection;
+        }
+
+        pi = label->width;
+        label = &m_states[i + 1][pi][label->next];
+    }
+    cascade.lastPi = pi;
+
+    return cascade;
+}
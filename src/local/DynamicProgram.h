@@ -0,0 +1,165 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef DYNAMIC_PROGRAM_H
+#define DYNAMIC_PROGRAM_H
+
+#include "CascadeSolver.h"
+
+/**
+ * @brief Exact native solver based on a layered dynamic program
+ * The cascade is a path through (stage, input size) states: each arc selects
+ * one filter and one shift (or leaves the stage empty). The states are solved
+ * backward and each of them keeps the non dominated tails according to the
+ * area, the rejection and the rejection allowed before the stage by the
+ * constraints on the output sizes. It solves the same problem as
+ * MaximizeRejection and MinimizeArea without Gurobi.
+ *
+ * @see MaximizeRejection
+ * @see MinimizeArea
+ */
+class DynamicProgram: public CascadeSolver {
+public:
+    using CascadeSolver::printResults;
+
+    /**
+     * @brief Select the criterion to optimize
+     */
+    enum class Mode {
+        MaximizeRejection,  /*!< Maximize the rejection under an area constraint */
+        MinimizeArea,       /*!< Minimize the area under a rejection constraint */
+        ParetoFront,        /*!< All the non dominated (area, rejection) cascades */
+    };
+
+    /**
+     * @brief Cascade rebuilt from the dynamic program
+     */
+    struct Cascade {
+        std::int64_t area;                      /*!< Total area */
+        double rejection;                       /*!< Total rejection */
+        std::int64_t lastPi;                    /*!< Output size of the last stage */
+        std::vector<SelectedFilter> filters;    /*!< Selected filter of each non empty stage */
+        std::vector<double> stageRejections;    /*!< Rejection of each stage */
+    };
+
+    /**
+     * @brief Constructor
+     *
+     * @param mode Criterion to optimize
+     * @param nbStage Total stage
+     * @param constraintLimit Area max or rejection min according to the mode (unused for the Pareto front)
+     * @param jsonPath Path to the filters description
+     * @param experimentName Name of experiment
+     */
+    DynamicProgram(Mode mode, const std::int64_t nbStage, const double constraintLimit, const std::string &jsonPath, const std::string &experimentName);
+
+    /**
+     * @brief Solve all the states and rebuild the best cascade
+     *
+     * @return true if a feasible cascade was found
+     */
+    bool solve() override;
+
+    /**
+     * @brief Get the optimal selected filters
+     */
+    const std::vector<SelectedFilter> &getSelectedFilters() const override;
+
+    /**
+     * @brief Get the non dominated cascades sorted by increasing area
+     * Only filled with the ParetoFront mode, the selected filters are then
+     * those of the cascade with the best rejection.
+     */
+    const std::vector<Cascade> &getParetoFront() const;
+
+    /**
+     * @brief Print the results to output stream
+     *
+     * @param out Output stream
+     */
+    void printResults(std::ostream &out = std::cout) override;
+
+private:
+    /**
+     * @brief Tail of cascade from a state to the last stage
+     */
+    struct Label {
+        std::int64_t area;      /*!< Area of the tail */
+        double rejection;       /*!< Rejection of the tail */
+        double headroom;        /*!< Max rejection allowed before the tail */
+        std::int32_t fir;       /*!< Filter of the first stage (-1 if empty) */
+        std::int32_t width;     /*!< Output size of the first stage */
+        std::int32_t next;      /*!< Index of the tail in the next state */
+    };
+
+    /**
+     * @brief Keep only the non dominated labels
+     *
+     * @param labels Labels to filter
+     */
+    static void keepNonDominated(std::vector<Label> &labels);
+
+    /**
+     * @brief Solve all the states backward, from the last stage to the first one
+     * The tails which can not improve the incumbent are discarded.
+     *
+     * @param beamWidth Max number of tails by state (0 to keep all of them)
+     */
+    void solveStates(std::size_t beamWidth);
+
+    /**
+     * @brief Get the index of the best feasible label of the first state
+     * The size of the first state is returned if there is no feasible label.
+     */
+    std::size_t selectBestLabel() const;
+
+    /**
+     * @brief Keep the non dominated (area, rejection) cascades of the first state
+     */
+    void buildParetoFront();
+
+    /**
+     * @brief Rebuild the cascade from a label of the first state
+     *
+     * @param index Index of the label in the first state
+     */
+    Cascade rebuildCascade(std::size_t index) const;
+
+    /**
+     * @brief Print a cascade to output stream
+     *
+     * @param cascade Cascade to print
+     * @param out Output stream
+     */
+    static void printCascade(const Cascade &cascade, std::ostream &out);
+
+private:
+    const Mode m_mode;
+    const std::int64_t m_nbStage;
+    const double m_constraintLimit;
+    double m_incumbent;
+
+    std::vector< std::vector< std::vector<Label> > > m_states;
+
+    Cascade m_cascade;
+    std::vector<Cascade> m_paretoFront;
+    double m_objectiveValue;
+    double m_computationTime;
+};
+
+#endif // DYNAMIC_PROGRAM_H
@@ -0,0 +1,58 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "Fft.h"
+
+#include <cmath>
+
+Fft::Fft(std::size_t size)
+: m_size(size)
+, m_twiddles(size / 2) {
+    for (std::size_t k = 0; k < size / 2; ++k) {
+        m_twiddles[k] = std::polar(1.0, -2.0 * M_PI * k / size);
+    }
+}
+
+std::size_t Fft::getSize() const {
+    return m_size;
+}
+
+void Fft::transform(std::vector< std::complex<double> > &data) const {
+    // Permutation bit-reverse
+    for (std::size_t i = 1, j = 0; i < m_size; ++i) {
+        std::size_t bit = m_size >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(data[i], data[j]);
+        }
+    }
+
+    for (std::size_t length = 2; length <= m_size; length <<= 1) {
+        const std::size_t stride = m_size / length;
+        for (std::size_t start = 0; start < m_size; start += length) {
+            for (std::size_t k = 0; k < length / 2; ++k) {
+                const std::complex<double> odd = data[start + k + length / 2] * m_twiddles[k * stride];
+                data[start + k + length / 2] = data[start + k] - odd;
+                data[start + k] += odd;
+            }
+        }
+    }
+}
@@ -0,0 +1,54 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex>
+#include <vector>
+
+/**
+ * @brief Radix-2 FFT of a power of two size, with precomputed twiddles
+ */
+class Fft {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param size Number of points (power of two)
+     */
+    Fft(std::size_t size);
+
+    /**
+     * @brief Get the number of points
+     */
+    std::size_t getSize() const;
+
+    /**
+     * @brief Compute the forward transform in place
+     *
+     * @param data Samples, replaced by their spectrum
+     */
+    void transform(std::vector< std::complex<double> > &data) const;
+
+private:
+    std::size_t m_size;
+    std::vector< std::complex<double> > m_twiddles;
+};
+
+#endif // FFT_H
@@ -0,0 +1,250 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "FilterBank.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace {
+    const char Magic[8] = { 'F', 'I', 'R', 'B', 'A', 'N', 'K', '\0' };
+
+    bool isNumber(const std::string &value) {
+        return !value.empty() && std::all_of(value.begin(), value.end(), [](char c) { return c >= '0' && c <= '9'; });
+    }
+}
+
+FilterBank::FilterBank(const std::string &path)
+: m_file(path)
+, m_header(nullptr)
+, m_families(nullptr)
+, m_entries(nullptr)
+, m_taps(nullptr)
+, m_open(false) {
+    if (!m_file.isOpen()) {
+        return;
+    }
+    m_open = validate();
+}
+
+bool FilterBank::isFilterBank(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(Magic)] = {0};
+    file.read(magic, sizeof(magic));
+    return file.good() && std::memcmp(magic, Magic, sizeof(Magic)) == 0;
+}
+
+bool FilterBank::write(const std::string &path, const std::vector<FilterBankFamily> &families) {
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.nbFamily = families.size();
+
+    // Les filtres de chaque famille sont triés pour la recherche par dichotomie
+    std::vector< std::vector<const FilterBankFilter *> > sorted(families.size());
+    std::vector<Family> familyTable(families.size());
+    for (std::size_t f = 0; f < families.size(); ++f) {
+        const FilterBankFamily &family = families[f];
+        if (family.name.empty() || family.name.size() >= sizeof(Family::name)) {
+            std::cerr << "FilterBank::write: The family name '" << family.name << "' is not valid" << std::endl;
+            return false;
+        }
+
+        std::memset(&familyTable[f], 0, sizeof(Family));
+        std::memcpy(familyTable[f].name, family.name.c_str(), family.name.size());
+        familyTable[f].firstFilter = header.nbFilter;
+        familyTable[f].nbFilter = family.filters.size();
+
+        for (const FilterBankFilter &filter: family.filters) {
+            if (filter.cardC == 0 || filter.taps.size() != filter.cardC) {
+                std::cerr << "FilterBank::write: The filter " << family.name << " (" << filter.cardC << " coefficients, " << filter.piC << " bits) has " << filter.taps.size() << " taps" << std::endl;
+                return false;
+            }
+            sorted[f].push_back(&filter);
+        }
+        std::stable_sort(sorted[f].begin(), sorted[f].end(), [](const FilterBankFilter *a, const FilterBankFilter *b) {
+            return std::make_pair(a->piC, a->cardC) < std::make_pair(b->piC, b->cardC);
+        });
+
+        header.nbFilter += family.filters.size();
+    }
+
+    std::vector<Entry> index;
+    index.reserve(header.nbFilter);
+    for (std::size_t f = 0; f < families.size(); ++f) {
+        for (const FilterBankFilter *filter: sorted[f]) {
+            Entry entry;
+            std::memset(&entry, 0, sizeof(entry));
+            entry.piC = filter->piC;
+            entry.cardC = filter->cardC;
+            entry.family = f;
+            entry.rejection = filter->rejection;
+            entry.firstTap = header.nbTap;
+            index.push_back(entry);
+            header.nbTap += filter->cardC;
+        }
+    }
+
+    header.familyOffset = sizeof(Header);
+    header.indexOffset = header.familyOffset + familyTable.size() * sizeof(Family);
+    header.tapOffset = header.indexOffset + index.size() * sizeof(Entry);
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(familyTable.data()), familyTable.size() * sizeof(Family));
+    file.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(Entry));
+    for (std::size_t f = 0; f < families.size(); ++f) {
+        for (const FilterBankFilter *filter: sorted[f]) {
+            file.write(reinterpret_cast<const char *>(filter->taps.data()), filter->taps.size() * sizeof(std::int32_t));
+        }
+    }
+
+    if (!file.good()) {
+        std::cerr << "FilterBank::write: Write '" << path << "': failed" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool FilterBank::isOpen() const {
+    return m_open;
+}
+
+std::size_t FilterBank::getNbFamily() const {
+    return m_header->nbFamily;
+}
+
+std::string FilterBank::getFamilyName(std::size_t family) const {
+    return m_families[family].name;
+}
+
+void FilterBank::getFamilyRange(std::size_t family, std::size_t &first, std::size_t &count) const {
+    first = m_families[family].firstFilter;
+    count = m_families[family].nbFilter;
+}
+
+std::size_t FilterBank::getNbFilter() const {
+    return m_header->nbFilter;
+}
+
+const FilterBank::Entry &FilterBank::getEntry(std::size_t index) const {
+    return m_entries[index];
+}
+
+const std::int32_t *FilterBank::getTaps(std::size_t index) const {
+    return m_taps + m_entries[index].firstTap;
+}
+
+std::int64_t FilterBank::find(const std::string &method, std::uint64_t cardC, std::uint64_t piC) const {
+    for (std::size_t f = 0; f < m_header->nbFamily; ++f) {
+        if (method != m_families[f].name) {
+            continue;
+        }
+
+        const Entry *first = m_entries + m_families[f].firstFilter;
+        const Entry *last = first + m_families[f].nbFilter;
+        const Entry *it = std::lower_bound(first, last, std::make_pair(piC, cardC), [](const Entry &entry, const std::pair<std::uint64_t, std::uint64_t> &key) {
+            return std::pair<std::uint64_t, std::uint64_t>(entry.piC, entry.cardC) < key;
+        });
+        if (it != last && it->piC == piC && it->cardC == cardC) {
+            return it - m_entries;
+        }
+        return -1;
+    }
+
+    return -1;
+}
+
+std::int64_t FilterBank::find(const std::string &filterName) const {
+    // Nom de la forme [filters/METHOD/]METHOD_CARDC_intPIC
+    const std::size_t slash = filterName.rfind('/');
+    const std::string name = (slash == std::string::npos) ? filterName : filterName.substr(slash + 1);
+
+    const std::size_t bits = name.rfind("_int");
+    if (bits == std::string::npos || bits == 0) {
+        return -1;
+    }
+    const std::size_t coeffs = name.rfind('_', bits - 1);
+    if (coeffs == std::string::npos) {
+        return -1;
+    }
+
+    const std::string cardC = name.substr(coeffs + 1, bits - coeffs - 1);
+    const std::string piC = name.substr(bits + 4);
+    if (!isNumber(cardC) || !isNumber(piC)) {
+        return -1;
+    }
+
+    return find(name.substr(0, coeffs), std::strtoull(cardC.c_str(), nullptr, 10), std::strtoull(piC.c_str(), nullptr, 10));
+}
+
+bool FilterBank::validate() {
+    const std::uint64_t size = m_file.getSize();
+    const char *data = m_file.getData();
+    if (size < sizeof(Header)) {
+        return false;
+    }
+
+    m_header = reinterpret_cast<const Header *>(data);
+    if (std::memcmp(m_header->magic, Magic, sizeof(Magic)) != 0 || m_header->version != Version) {
+        return false;
+    }
+
+    // Chaque table doit être alignée et contenue dans le fichier
+    auto fits = [size](std::uint64_t offset, std::uint64_t count, std::uint64_t elementSize, std::uint64_t alignment) {
+        return offset % alignment == 0 && offset <= size && count <= (size - offset) / elementSize;
+    };
+    if (!fits(m_header->familyOffset, m_header->nbFamily, sizeof(Family), alignof(Family))
+        || !fits(m_header->indexOffset, m_header->nbFilter, sizeof(Entry), alignof(Entry))
+        || !fits(m_header->tapOffset, m_header->nbTap, sizeof(std::int32_t), alignof(std::int32_t))) {
+        return false;
+    }
+
+    m_families = reinterpret_cast<const Family *>(data + m_header->familyOffset);
+    m_entries = reinterpret_cast<const Entry *>(data + m_header->indexOffset);
+    m_taps = reinterpret_cast<const std::int32_t *>(data + m_header->tapOffset);
+
+    for (std::size_t f = 0; f < m_header->nbFamily; ++f) {
+        const Family &family = m_families[f];
+        if (std::memchr(family.name, '\0', sizeof(family.name)) == nullptr
+            || family.firstFilter > m_header->nbFilter || family.nbFilter > m_header->nbFilter - family.firstFilter) {
+            return false;
+        }
+        for (std::size_t i = family.firstFilter; i < family.firstFilter + family.nbFilter; ++i) {
+            // La recherche par dichotomie suppose les filtres triés par (piC, cardC)
+            if (m_entries[i].family != f || (i > family.firstFilter && std::make_pair(m_entries[i].piC, m_entries[i].cardC) < std::make_pair(m_entries[i - 1].piC, m_entries[i - 1].cardC))) {
+                return false;
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < m_header->nbFilter; ++i) {
+        const Entry &entry = m_entries[i];
+        if (entry.family >= m_header->nbFamily || entry.firstTap > m_header->nbTap || entry.cardC > m_header->nbTap - entry.firstTap) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,205 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef FILTER_BANK_H
+#define FILTER_BANK_H
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+/**
+ * @brief Filter of a family to write in a filter bank
+ */
+struct FilterBankFilter {
+    std::uint16_t piC;                  /*!< Size of the coefficients */
+    std::uint16_t cardC;                /*!< Number of coefficients */
+    double rejection;                   /*!< Rejection of the filter */
+    std::vector<std::int32_t> taps;     /*!< Integer coefficients (cardC values) */
+};
+
+/**
+ * @brief Family of filters (one generation method) to write in a filter bank
+ */
+struct FilterBankFamily {
+    std::string name;                       /*!< Name of the generation method */
+    std::vector<FilterBankFilter> filters;  /*!< Filters of the family */
+};
+
+/**
+ * @brief Read only view of a filter bank archive
+ * The archive replaces the JSON file, its configuration files and the
+ * coefficient files of filters/: a whole library is one file, mapped in
+ * memory, so opening it only reads the header. The layout (native endianness)
+ * is:
+ * - a header of 64 bytes (magic, version, counts and offsets of the tables);
+ * - the family table: name (32 bytes) and range of filters of each family;
+ * - the index: piC, cardC, family, rejection and first tap of each filter,
+ *   sorted by (piC, cardC) in each family;
+ * - the taps of all the filters, packed on int32.
+ */
+class FilterBank {
+public:
+    /**
+     * @brief Current version of the format
+     */
+    static constexpr std::uint32_t Version = 1;
+
+    /**
+     * @brief Entry of the index
+     */
+    struct Entry {
+        std::uint16_t piC;          /*!< Size of the coefficients */
+        std::uint16_t cardC;        /*!< Number of coefficients */
+        std::uint32_t family;       /*!< Index of the family */
+        double rejection;           /*!< Rejection of the filter */
+        std::uint64_t firstTap;     /*!< Index of the first coefficient in the taps */
+    };
+
+    /**
+     * @brief Constructor
+     * The archive is not opened if its header, its version or one of its
+     * tables is not valid.
+     *
+     * @param path Path of the archive
+     */
+    FilterBank(const std::string &path);
+
+    /**
+     * @brief Check if a file starts with the magic of a filter bank
+     *
+     * @param path Path of the file
+     */
+    static bool isFilterBank(const std::string &path);
+
+    /**
+     * @brief Write a filter bank
+     * The filters of each family are sorted by (piC, cardC).
+     *
+     * @param path Path of the archive
+     * @param families Families of filters
+     * @return false if a filter is not valid or the file can not be written
+     */
+    static bool write(const std::string &path, const std::vector<FilterBankFamily> &families);
+
+    /**
+     * @brief Check if the archive could be opened
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Get the number of families
+     */
+    std::size_t getNbFamily() const;
+
+    /**
+     * @brief Get the name of a family
+     *
+     * @param family Index of the family
+     */
+    std::string getFamilyName(std::size_t family) const;
+
+    /**
+     * @brief Get the range [first, first + count) of the filters of a family
+     *
+     * @param family Index of the family
+     * @param first Index of the first filter
+     * @param count Number of filters
+     */
+    void getFamilyRange(std::size_t family, std::size_t &first, std::size_t &count) const;
+
+    /**
+     * @brief Get the number of filters of all the families
+     */
+    std::size_t getNbFilter() const;
+
+    /**
+     * @brief Get the index entry of a filter
+     *
+     * @param index Index of the filter
+     */
+    const Entry &getEntry(std::size_t index) const;
+
+    /**
+     * @brief Get the coefficients of a filter (cardC values)
+     *
+     * @param index Index of the filter
+     */
+    const std::int32_t *getTaps(std::size_t index) const;
+
+    /**
+     * @brief Find a filter by its configuration
+     *
+     * @param method Name of the family
+     * @param cardC Number of coefficients
+     * @param piC Size of the coefficients
+     * @return Index of the filter, or -1 if it is not in the archive
+     */
+    std::int64_t find(const std::string &method, std::uint64_t cardC, std::uint64_t piC) const;
+
+    /**
+     * @brief Find a filter by its coefficient file name (see Fir::getFilterName)
+     * Only the last component of the name is used: "METHOD_CARDC_intPIC".
+     *
+     * @param filterName Name of the coefficient file
+     * @return Index of the filter, or -1 if it is not in the archive
+     */
+    std::int64_t find(const std::string &filterName) const;
+
+private:
+    /**
+     * @brief Family of the family table
+     */
+    struct Family {
+        char name[32];              /*!< Name, ended by a null character */
+        std::uint64_t firstFilter;  /*!< Index of the first filter */
+        std::uint64_t nbFilter;     /*!< Number of filters */
+    };
+
+    /**
+     * @brief Header of the archive
+     */
+    struct Header {
+        char magic[8];              /*!< "FIRBANK" */
+        std::uint32_t version;      /*!< Version of the format */
+        std::uint32_t nbFamily;     /*!< Number of families */
+        std::uint64_t nbFilter;     /*!< Number of filters */
+        std::uint64_t nbTap;        /*!< Number of coefficients of all the filters */
+        std::uint64_t familyOffset; /*!< Offset of the family table */
+        std::uint64_t indexOffset;  /*!< Offset of the index */
+        std::uint64_t tapOffset;    /*!< Offset of the taps */
+        std::uint64_t reserved;     /*!< Unused, zero */
+    };
+
+    /**
+     * @brief Check the header and the tables of the mapped file
+     */
+    bool validate();
+
+private:
+    MappedFile m_file;
+    const Header *m_header;
+    const Family *m_families;
+    const Entry *m_entries;
+    const std::int32_t *m_taps;
+    bool m_open;
+};
+
+#endif // FILTER_BANK_H
@@ -0,0 +1,476 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "LayeredFlow.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+LayeredFlow::LayeredFlow(Mode mode, const std::int64_t nbStage, const double constraintLimit, const std::string &jsonPath, const std::string &experimentName, GRBEnv *env, bool withNames)
+: QuadraticProgram(experimentName, env, withNames)
+, m_areaValue(0.0)
+, m_rejectionValue(0.0)
+, m_lastPi(0.0)
+, m_computationTime(0.0)
+, m_areaBound(0.0) {
+    // Load all the filter configurations
+    loadFilterLibrary(jsonPath);
+    auto tStart = std::chrono::high_resolution_clock::now();
+
+    // Déclaration des constantes internes
+    const std::int64_t NbConfFir = m_firs.size();
+    const std::int64_t NbStage = nbStage;
+    const std::int64_t PiIn = 16; // PRN input
+    // const std::int64_t PiIn = 7; // ADC input
+    const std::int64_t PiMax = 256;
+    const double AMax = (mode == Mode::MaximizeRejection) ? constraintLimit : std::numeric_limits<double>::infinity();
+
+    // Tailles possibles en entrée de chaque étage (pi_(i-1) >= i + 1 avec les bits de signe et de sécurité)
+    std::int64_t maxPiFir = 0;
+    for (const Fir &fir: m_firs) {
+        maxPiFir = std::max(maxPiFir, fir.getPiFir());
+    }
+    m_minPi.assign(NbStage + 1, PiIn);
+    m_maxPi.assign(NbStage + 1, PiIn);
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        m_minPi[i + 1] = i + 2;
+        m_maxPi[i + 1] = std::min(PiMax, m_maxPi[i] + maxPiFir);
+    }
+
+    // Aire minimale des étages précédents pour atteindre chaque taille (sans les contraintes sur pi_i)
+    std::vector< std::vector<double> > minArea(NbStage + 1, std::vector<double>(PiMax + 1, std::numeric_limits<double>::infinity()));
+    minArea[0][PiIn] = 0.0;
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        for (std::int64_t p = m_minPi[i]; p <= m_maxPi[i]; ++p) {
+            minArea[i + 1][p] = std::min(minArea[i + 1][p], minArea[i][p]);
+            for (const Fir &fir: m_firs) {
+                const std::int64_t q = std::min(PiMax, p + fir.getPiFir());
+                minArea[i + 1][q] = std::min(minArea[i + 1][q], minArea[i][p] + fir.getCardC() * (fir.getPiC() + p));
+            }
+        }
+        for (std::int64_t q = PiMax - 1; q >= 0; --q) {
+            minArea[i + 1][q] = std::min(minArea[i + 1][q], minArea[i + 1][q + 1]);
+        }
+    }
+
+    // Déclaration des arcs de filtre, créés en un seul bloc
+    m_var_fir.resize(NbStage);
+    std::vector<std::int64_t> arcStage;
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        for (std::int64_t p = m_minPi[i]; p <= m_maxPi[i]; ++p) {
+            for (std::int64_t j = 0; j < NbConfFir; ++j) {
+                const Fir &currentFir = m_firs[j];
+                const double area = currentFir.getCardC() * (currentFir.getPiC() + p);
+                const std::int64_t piOut = p + currentFir.getPiFir();
+                if (piOut < m_minPi[i + 1] || piOut > PiMax || minArea[i][p] + area > AMax) {
+                    continue;
+                }
+
+                FilterArc arc = { j, p, GRBVar() };
+                m_var_fir[i].push_back(arc);
+                arcStage.push_back(i);
+            }
+        }
+    }
+    {
+        std::vector<FilterArc *> arcs;
+        for (std::int64_t i = 0; i < NbStage; ++i) {
+            for (FilterArc &arc: m_var_fir[i]) {
+                arcs.push_back(&arc);
+            }
+        }
+        std::vector<GRBVar> vars = addVars(arcs.size(), 0.0, 1.0, GRB_BINARY, [&](std::size_t k) { return getName("fir", { arcStage[k], arcs[k]->fir, arcs[k]->piIn }); });
+        for (std::size_t k = 0; k < arcs.size(); ++k) {
+            arcs[k]->var = vars[k];
+        }
+    }
+
+    // Déclaration des arcs d'étage vide
+    m_var_empty.resize(NbStage);
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        m_var_empty[i].resize(PiMax + 1);
+        for (std::int64_t p = m_minPi[i]; p <= m_maxPi[i]; ++p) {
+            if (hasEmptyArc(i, p)) {
+                m_var_empty[i][p] = m_model.addVar(0.0, 1.0, 0.0, GRB_BINARY, getName("empty", { i, p }));
+            }
+        }
+    }
+
+    // Déclaration des arcs de sortie (taille pi_i après le shift)
+    m_var_exit.resize(NbStage);
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        m_var_exit[i].resize(PiMax + 1);
+        for (std::int64_t q = m_minPi[i + 1]; q <= m_maxPi[i + 1]; ++q) {
+            m_var_exit[i][q] = m_model.addVar(0.0, 1.0, 0.0, GRB_BINARY, getName("exit", { i, q }));
+        }
+    }
+
+    // Déclaration des arcs de shift d'un bit (de q vers q - 1)
+    m_var_shift.resize(NbStage);
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        m_var_shift[i].resize(PiMax + 1);
+        for (std::int64_t q = m_minPi[i + 1] + 1; q <= m_maxPi[i + 1]; ++q) {
+            m_var_shift[i][q] = m_model.addVar(0.0, 1.0, 0.0, GRB_CONTINUOUS, getName("shift", { i, q }));
+        }
+    }
+
+    // Déclaration des a, r et pi
+    m_var_a.resize(NbStage);
+    m_var_r.resize(NbStage);
+    m_var_pi.resize(NbStage);
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        m_var_a[i] = m_model.addVar(0.0, GRB_INFINITY, 0.0, GRB_CONTINUOUS, getName("a", { i }));
+        m_var_r[i] = m_model.addVar(0.0, GRB_INFINITY, 0.0, GRB_CONTINUOUS, getName("r", { i }));
+        m_var_pi[i] = m_model.addVar(0.0, PiMax, 0.0, GRB_CONTINUOUS, getName("pi", { i }));
+    }
+
+    // Déclaration des contraintes
+    // Conservation du flot en entrée de chaque étage
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        std::vector<GRBLinExpr> flow(PiMax + 1, 0);
+
+        // Flot entrant
+        if (i == 0) {
+            flow[PiIn] -= 1.0;
+        }
+        else {
+            for (std::int64_t p = m_minPi[i]; p <= m_maxPi[i]; ++p) {
+                flow[p] -= m_var_exit[i - 1][p];
+                if (hasEmptyArc(i - 1, p)) {
+                    flow[p] -= m_var_empty[i - 1][p];
+                }
+            }
+        }
+
+        // Flot sortant
+        for (const FilterArc &arc: m_var_fir[i]) {
+            flow[arc.piIn] += arc.var;
+        }
+        for (std::int64_t p = m_minPi[i]; p <= m_maxPi[i]; ++p) {
+            if (hasEmptyArc(i, p)) {
+                flow[p] += m_var_empty[i][p];
+            }
+        }
+
+        std::vector<GRBLinExpr> exprs(flow.begin() + m_minPi[i], flow.begin() + m_maxPi[i] + 1);
+        addConstrs(exprs, GRB_EQUAL, 0.0, [&](std::size_t k) { return getName("cstr_flow_in", { i, m_minPi[i] + static_cast<std::int64_t>(k) }); });
+    }
+
+    // Conservation du flot en sortie des filtres : chaque bit de shift descend d'un niveau
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        std::vector<GRBLinExpr> flow(PiMax + 1, 0);
+
+        for (const FilterArc &arc: m_var_fir[i]) {
+            flow[arc.piIn + m_firs[arc.fir].getPiFir()] -= arc.var;
+        }
+        for (std::int64_t q = m_minPi[i + 1]; q <= m_maxPi[i + 1]; ++q) {
+            flow[q] += m_var_exit[i][q];
+            if (q > m_minPi[i + 1]) {
+                flow[q] += m_var_shift[i][q];
+            }
+            if (q < m_maxPi[i + 1]) {
+                flow[q] -= m_var_shift[i][q + 1];
+            }
+        }
+
+        std::vector<GRBLinExpr> exprs(flow.begin() + m_minPi[i + 1], flow.begin() + m_maxPi[i + 1] + 1);
+        addConstrs(exprs, GRB_EQUAL, 0.0, [&](std::size_t k) { return getName("cstr_flow_out", { i, m_minPi[i + 1] + static_cast<std::int64_t>(k) }); });
+    }
+
+    // Définition de la taille occupée et de la rejection (linéaires : la taille d'entrée est connue sur chaque arc)
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        const std::size_t nbArc = m_var_fir[i].size();
+        std::vector<GRBVar> vars(nbArc);
+        std::vector<double> areas(nbArc);
+        std::vector<double> noises(nbArc);
+        for (std::size_t k = 0; k < nbArc; ++k) {
+            const FilterArc &arc = m_var_fir[i][k];
+            const Fir &currentFir = m_firs[arc.fir];
+            vars[k] = arc.var;
+            areas[k] = currentFir.getCardC() * (currentFir.getPiC() + arc.piIn);
+            noises[k] = currentFir.getNoiseLevel();
+        }
+
+        GRBLinExpr area = -m_var_a[i];
+        GRBLinExpr rejection = -m_var_r[i];
+        area.addTerms(areas.data(), vars.data(), nbArc);
+        rejection.addTerms(noises.data(), vars.data(), nbArc);
+
+        m_model.addConstr(area, GRB_EQUAL, 0.0, getName("cstr_a", { i }));
+        m_model.addConstr(rejection, GRB_EQUAL, 0.0, getName("cstr_r", { i }));
+    }
+
+    // Définition de la taille des données en sortie à chaque étage
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        GRBLinExpr expr = 0;
+
+        expr -= m_var_pi[i];
+        for (std::int64_t q = m_minPi[i + 1]; q <= m_maxPi[i + 1]; ++q) {
+            expr += m_var_exit[i][q] * static_cast<double>(q);
+            if (hasEmptyArc(i, q)) {
+                expr += m_var_empty[i][q] * static_cast<double>(q);
+            }
+        }
+
+        m_model.addConstr(expr, GRB_EQUAL, 0.0, getName("cstr_pi", { i }));
+    }
+
+    // Contrainte sur la taille en sortie
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        GRBLinExpr expr = 0;
+
+        // Somme des rejections précédentes (avec shift)
+        for (std::int64_t stage = 0; stage <= i; ++stage) {
+            expr += (1.0/6.0) * m_var_r[stage];
+
+            // Pour prendre en compte le bit de signe
+            expr += 1;
+
+#ifdef FIX_REJECTION_CONSTRAINT
+            // Pour prendre en compte le bit de signe - si un filtre est séléctionné
+            for (const FilterArc &arc: m_var_fir[i]) {
+                expr += arc.var;
+            }
+#endif
+        }
+
+        // Ajout d'un bit de sécurité (Utile ?)
+        expr += 1;
+
+        m_model.addConstr(expr, GRB_LESS_EQUAL, m_var_pi[i], getName("cstr_pi_i_min", { i }));
+    }
+
+    // Contrainte sur la taille max ou la rejection min
+    {
+        GRBLinExpr area = 0;
+        GRBLinExpr rejection = 0;
+        for (std::int64_t i = 0; i < NbStage; ++i) {
+            area += m_var_a[i];
+            rejection += m_var_r[i];
+        }
+
+        if (mode == Mode::MaximizeRejection) {
+            m_cstr_limit = m_model.addConstr(area, GRB_LESS_EQUAL, AMax, getName("cstr_A_max", {}));
+            m_model.setObjective(rejection, GRB_MAXIMIZE);
+        }
+        else {
+            m_cstr_limit = m_model.addConstr(rejection, GRB_GREATER_EQUAL, constraintLimit, getName("cstr_rejection_min", {}));
+            m_model.setObjective(area, GRB_MINIMIZE);
+        }
+    }
+
+    // Paramètres modifiables sans reconstruire le modèle
+    m_maximizeRejection = (mode == Mode::MaximizeRejection);
+    m_nbStage = NbStage;
+    m_piIn = PiIn;
+    m_constraintLimit = constraintLimit;
+    m_areaBound = AMax;
+
+    // Point de départ construit par l'heuristique gloutonne
+    setGreedyStart(NbStage, PiIn, mode == Mode::MaximizeRejection, constraintLimit);
+
+    finishBuild(tStart);
+}
+
+bool LayeredFlow::solve() {
+    auto tStart = std::chrono::high_resolution_clock::now();
+
+    // Execute le programme linéaire
+    m_model.optimize();
+
+    auto tEnd = std::chrono::high_resolution_clock::now();
+
+    m_computationTime = std::chrono::duration<double>(tEnd-tStart).count();
+    std::cout << "Wall clock time passed: " << m_computationTime << "s" << std::endl;
+
+    // Aucune solution trouvée
+    if (m_model.get(GRB_IntAttr_SolCount) == 0) {
+        m_selectedFilters.clear();
+        return false;
+    }
+
+    const std::int64_t NbStage = m_var_fir.size();
+
+    m_selectedFilters.clear();
+    m_areaValue = 0.0;
+    m_rejectionValue = 0.0;
+
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        for (const FilterArc &arc: m_var_fir[i]) {
+            bool selected = static_cast<bool>(std::round(arc.var.get(GRB_DoubleAttr_X)));
+
+            if (selected) {
+                Fir &fir = m_firs[arc.fir];
+                double rejection = m_var_r[i].get(GRB_DoubleAttr_X);
+                std::int64_t piIn = arc.piIn;
+                std::int64_t piFir = fir.getPiFir();
+                std::int64_t piOut = std::round(m_var_pi[i].get(GRB_DoubleAttr_X));
+                std::int64_t shift = piIn + piFir - piOut;
+
+                SelectedFilter filter = { i, fir, rejection, shift, piIn, piFir, piOut };
+                m_selectedFilters.emplace_back(filter);
+            }
+        }
+    }
+
+    // Calcul des valeurs importantes
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        m_areaValue += m_var_a[i].get(GRB_DoubleAttr_X);
+        m_rejectionValue += m_var_r[i].get(GRB_DoubleAttr_X);
+    }
+    m_lastPi = m_var_pi[NbStage - 1].get(GRB_DoubleAttr_X);
+
+    return true;
+}
+
+void LayeredFlow::setStart(const std::vector<SelectedFilter> &filters) {
+    const std::int64_t NbStage = m_var_fir.size();
+
+    // Un départ infaisable serait rejeté par Gurobi, le départ courant est alors gardé
+    const std::vector<SelectedFilter> start = adaptCascade(filters, NbStage, m_piIn, m_maximizeRejection, m_constraintLimit);
+    if (start.empty()) {
+        return;
+    }
+
+    // Tous les arcs sont vides par défaut
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        for (FilterArc &arc: m_var_fir[i]) {
+            arc.var.set(GRB_DoubleAttr_Start, 0.0);
+        }
+        for (std::int64_t p = m_minPi[i]; p <= m_maxPi[i]; ++p) {
+            if (hasEmptyArc(i, p)) {
+                m_var_empty[i][p].set(GRB_DoubleAttr_Start, 0.0);
+            }
+        }
+        for (std::int64_t q = m_minPi[i + 1]; q <= m_maxPi[i + 1]; ++q) {
+            m_var_exit[i][q].set(GRB_DoubleAttr_Start, 0.0);
+            if (q > m_minPi[i + 1]) {
+                m_var_shift[i][q].set(GRB_DoubleAttr_Start, 0.0);
+            }
+        }
+    }
+
+    // Chemin suivi par le flot
+    std::int64_t pi = m_minPi[0];
+    std::size_t index = 0;
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        double area = 0.0;
+        double rejection = 0.0;
+
+        if (index < start.size() && start[index].stage == i) {
+            const SelectedFilter &filter = start[index];
+            std::int64_t j = findFir(filter.filter);
+            for (FilterArc &arc: m_var_fir[i]) {
+                if (arc.fir == j && arc.piIn == pi) {
+                    arc.var.set(GRB_DoubleAttr_Start, 1.0);
+                }
+            }
+
+            // Descente de la chaîne de shift jusqu'à la taille de sortie
+            const std::int64_t piFir = pi + filter.piFir;
+            for (std::int64_t q = filter.piOut + 1; q <= std::min(piFir, m_maxPi[i + 1]); ++q) {
+                m_var_shift[i][q].set(GRB_DoubleAttr_Start, 1.0);
+            }
+            if (filter.piOut >= m_minPi[i + 1] && filter.piOut <= m_maxPi[i + 1]) {
+                m_var_exit[i][filter.piOut].set(GRB_DoubleAttr_Start, 1.0);
+            }
+
+            area = filter.filter.getCardC() * (filter.filter.getPiC() + pi);
+            rejection = filter.rejection;
+            pi = filter.piOut;
+            ++index;
+        }
+        else if (hasEmptyArc(i, pi)) {
+            m_var_empty[i][pi].set(GRB_DoubleAttr_Start, 1.0);
+        }
+
+        m_var_a[i].set(GRB_DoubleAttr_Start, area);
+        m_var_r[i].set(GRB_DoubleAttr_Start, rejection);
+        m_var_pi[i].set(GRB_DoubleAttr_Start, pi);
+    }
+}
+
+bool LayeredFlow::isUpdatable(const double constraintLimit, const std::int64_t piIn) const {
+    // Les tailles d'entrée et les arcs élagués dépendent de PiIn et de AMax
+    if (piIn != m_piIn) {
+        return false;
+    }
+
+    return !m_maximizeRejection || constraintLimit <= m_areaBound;
+}
+
+void LayeredFlow::getStageSelection(std::int64_t stage, std::vector<std::int64_t> &firs, std::vector<GRBVar> &vars) const {
+    firs.clear();
+    vars.clear();
+    for (const FilterArc &arc: m_var_fir[stage]) {
+        firs.push_back(arc.fir);
+        vars.push_back(arc.var);
+    }
+}
+
+bool LayeredFlow::hasEmptyArc(std::int64_t i, std::int64_t p) const {
+    // Un étage vide garde la même taille
+    return p >= std::max(m_minPi[i], m_minPi[i + 1]) && p <= m_maxPi[i];
+}
+
+const std::vector<SelectedFilter> &LayeredFlow::getSelectedFilters() const {
+    return m_selectedFilters;
+}
+
+void LayeredFlow::printResults(std::ostream &out) {
+    m_model.update();
+
+    out << std::endl;
+    out << "Build Time = " << m_buildTime << " seconds" << std::endl;
+    out << "Computation Time = " << m_computationTime << " seconds" << std::endl;
+
+    out << std::endl;
+    out << "### Main criteria ###" << std::endl;
+    out << "Objectif = " << m_model.get(GRB_DoubleAttr_ObjVal) << std::endl;
+    out << "Area = " << m_areaValue << std::endl;
+    out << "Rejection = " << m_rejectionValue << std::endl;
+    out << "Last pi_i = " << m_lastPi << std::endl;
+
+    out << std::endl;
+    out << "### Selected filters ###" << std::endl;
+    int i = 0;
+    for (const SelectedFilter &filter: m_selectedFilters) {
+        out << "Stage #" << filter.stage << std::endl;
+        out << filter.filter << std::endl;
+        out << "pi_in: " << filter.piIn << std::endl;
+        out << "pi_fir: " << filter.piFir << std::endl;
+        out << "pi_out: " << filter.piOut << std::endl;
+        out << "r_i: " << filter.rejection << std::endl;
+        out << "r_i/6: " << filter.rejection / 6.0 << std::endl;
+        out << "With shift: " << filter.shift << std::endl;
+        out << "Stage rejection: " << m_var_r[i].get(GRB_DoubleAttr_X) << std::endl;
+        ++i;
+    }
+
+    out << std::endl;
+    out << "### Command for the C++ simulator" << std::endl;
+    out << "./cascaded-filters data_prn.bin simu_stage.bin ";
+    for (std::size_t stage = 0; stage < m_selectedFilters.size(); ++stage) {
+        const SelectedFilter &filter = m_selectedFilters[stage];
+        out << filter.filter.getFilterName() << " " << filter.shift << " " << filter.piOut << " ";
+    }
+    out << std::endl;
+}
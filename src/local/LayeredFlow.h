@@ -0,0 +1,151 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef LAYERED_FLOW_H
+#define LAYERED_FLOW_H
+
+#include "QuadraticProgram.h"
+
+/**
+ * @brief Linear program on a layered graph of (stage, size) nodes
+ * A unit of flow goes from the input of the first stage to the output of the
+ * last one. At each stage, it either skips the stage or takes the arc of one
+ * filter from its input size p to the size p + pi_fir, then goes down a
+ * chain of one bit shifts to the output size. The area of each filter arc is
+ * known in advance, so the model is a pure MILP with the same optimum as
+ * MaximizeRejection and MinimizeArea. The output of a filter is limited to
+ * PiMax bits before the shift.
+ *
+ * @see MaximizeRejection
+ * @see MinimizeArea
+ */
+class LayeredFlow: public QuadraticProgram {
+public:
+    using QuadraticProgram::printResults;
+
+    /**
+     * @brief Select the criterion to optimize
+     */
+    enum class Mode {
+        MaximizeRejection,  /*!< Maximize the rejection under an area constraint */
+        MinimizeArea,       /*!< Minimize the area under a rejection constraint */
+    };
+
+    /**
+     * @brief Constructor
+     *
+     * @param mode Criterion to optimize
+     * @param nbStage Total stage
+     * @param constraintLimit Area max or rejection min according to the mode
+     * @param jsonPath Path to the filters description
+     * @param experimentName Name of experiment
+     * @param env Gurobi environnement to share (a new one is created if null)
+     * @param withNames Name the variables and the constraints (for the LP file)
+     */
+    LayeredFlow(Mode mode, const std::int64_t nbStage, const double constraintLimit, const std::string &jsonPath, const std::string &experimentName, GRBEnv *env = nullptr, bool withNames = false);
+
+    /**
+     * @brief Get the optimal selected filters
+     */
+    const std::vector<SelectedFilter> &getSelectedFilters() const override;
+
+    /**
+     * @brief Optimize the model and read the solution
+     *
+     * @return true if a solution was found
+     */
+    bool solve() override;
+
+    /**
+     * @brief Use a known cascade as MIP start
+     * The flow follows the path of the cascade, the stages without filter
+     * are empty.
+     * The cascade is first adapted to the stages of the model (see
+     * adaptCascade()) and ignored if it is not feasible.
+     *
+     * @param filters Selected filters of the known cascade
+     */
+    void setStart(const std::vector<SelectedFilter> &filters) override;
+
+    /**
+     * @brief Print the results to output stream
+     *
+     * @param out Output stream
+     */
+    void printResults(std::ostream &out = std::cout) override;
+
+protected:
+    /**
+     * @brief Check if the built model can be updated to a new problem
+     * The input size can not change and the area max can not be larger than
+     * the one used to prune the arcs.
+     *
+     * @param constraintLimit New area max or rejection min
+     * @param piIn New input size
+     */
+    bool isUpdatable(const double constraintLimit, const std::int64_t piIn) const override;
+
+    /**
+     * @brief Get the filter arcs of a stage
+     * A filter has one arc by input size of the stage.
+     *
+     * @param stage Stage
+     * @param firs Index of the filter of each variable
+     * @param vars Variables
+     */
+    void getStageSelection(std::int64_t stage, std::vector<std::int64_t> &firs, std::vector<GRBVar> &vars) const override;
+
+private:
+    /**
+     * @brief Arc selecting a filter for a given input size
+     */
+    struct FilterArc {
+        std::int64_t fir;   /*!< Index of the filter */
+        std::int64_t piIn;  /*!< Input size of the stage */
+        GRBVar var;         /*!< Flow on the arc */
+    };
+
+    /**
+     * @brief Check if the arc of an empty stage exists
+     *
+     * @param i Stage
+     * @param p Input size of the stage
+     */
+    bool hasEmptyArc(std::int64_t i, std::int64_t p) const;
+
+private:
+    std::vector<std::int64_t> m_minPi;
+    std::vector<std::int64_t> m_maxPi;
+
+    std::vector< std::vector<FilterArc> > m_var_fir;
+    std::vector< std::vector<GRBVar> > m_var_empty;
+    std::vector< std::vector<GRBVar> > m_var_exit;
+    std::vector< std::vector<GRBVar> > m_var_shift;
+    std::vector<GRBVar> m_var_a;
+    std::vector<GRBVar> m_var_r;
+    std::vector<GRBVar> m_var_pi;
+
+    std::vector<SelectedFilter> m_selectedFilters;
+    double m_areaValue;
+    double m_rejectionValue;
+    double m_lastPi;
+    double m_computationTime;
+    double m_areaBound;
+};
+
+#endif // LAYERED_FLOW_H
@@ -0,0 +1,96 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "MappedFile.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define WITH_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <fstream>
+
+MappedFile::MappedFile(const std::string &path)
+: m_data(nullptr)
+, m_size(0)
+, m_open(false)
+, m_mapped(false) {
+#ifdef WITH_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat status;
+    if (::fstat(fd, &status) == 0) {
+        m_size = status.st_size;
+        m_open = true;
+
+        // Un fichier vide ne peut pas être projeté
+        if (m_size > 0) {
+            void *data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                ::madvise(data, m_size, MADV_SEQUENTIAL);
+                m_data = static_cast<const char *>(data);
+                m_mapped = true;
+            }
+        }
+    }
+    ::close(fd);
+
+    if (m_mapped || !m_open || m_size == 0) {
+        return;
+    }
+    m_open = false;
+#endif
+
+    // Lecture complète si la projection n'est pas disponible
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (file.fail()) {
+        return;
+    }
+    m_size = file.tellg();
+    m_buffer.resize(m_size);
+    file.seekg(0);
+    file.read(m_buffer.data(), m_size);
+    m_data = m_buffer.data();
+    m_open = file.good();
+}
+
+MappedFile::~MappedFile() {
+#ifdef WITH_MMAP
+    if (m_mapped) {
+        ::munmap(const_cast<char *>(m_data), m_size);
+    }
+#endif
+}
+
+bool MappedFile::isOpen() const {
+    return m_open;
+}
+
+const char *MappedFile::getData() const {
+    return m_data;
+}
+
+std::uint64_t MappedFile::getSize() const {
+    return m_size;
+}
@@ -0,0 +1,71 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Read only view of a whole binary file
+ * The file is mapped in memory when the system supports it (the pages are
+ * read on demand, without copy), read in a buffer otherwise.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param path Path of the file
+     */
+    MappedFile(const std::string &path);
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /**
+     * @brief Destructor
+     */
+    ~MappedFile();
+
+    /**
+     * @brief Check if the file could be opened
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Get the content of the file
+     */
+    const char *getData() const;
+
+    /**
+     * @brief Get the size of the file in bytes
+     */
+    std::uint64_t getSize() const;
+
+private:
+    const char *m_data;
+    std::uint64_t m_size;
+    bool m_open;
+    bool m_mapped;
+    std::vector<char> m_buffer;
+};
+
+#endif // MAPPED_FILE_H
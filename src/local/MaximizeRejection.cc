@@ -21,41 +21,18 @@
 #include <cassert>
 #include <chrono>
 #include <cmath>
-#include <filesystem>
 #include <iostream>
 
-#include <nlohmann/json.hpp>
-
-using json = nlohmann::json;
-namespace fs = std::filesystem;
-
-MaximizeRejection::MaximizeRejection(const std::int64_t nbStage, const double areaMax, const std::string &jsonPath, const std::string &experimentName)
-: QuadraticProgram(experimentName)
+MaximizeRejection::MaximizeRejection(const std::int64_t nbStage, const double areaMax, const std::string &jsonPath, const std::string &experimentName, GRBEnv *env, bool withNames, bool compact)
+: QuadraticProgram(experimentName, env, withNames)
+, m_compact(compact)
 , m_areaValue(0.0)
 , m_rejectionValue(0.0)
 , m_lastPi(0.0)
 , m_computationTime(0.0) {
-    // Read JSON file to get the filters file loctations
-    std::ifstream jsonFile(jsonPath, std::ios::binary);
-    if (jsonFile.fail()) {
-        std::cerr << "MaximizeRejection::MaximizeRejection: The json file '" << jsonPath << "' is missing" << std::endl;
-        std::exit(-1);
-    }
-
-    // Get relative path
-    fs::path filtersDirectory = fs::path(jsonPath).parent_path();
-
-    // Create an object json
-    json jsonData;
-    jsonFile >> jsonData;
-
-    // Add all filters
-    for (auto& element : jsonData.items()) {
-        std::string filterPath(filtersDirectory.string() + "/" + static_cast<std::string>(element.value()));
-        loadFirConfiguration(filterPath, element.key());
-    }
-
-    std::cout << "Total config FIR: " << m_firs.size() << std::endl;
+    // Load all the filter configurations
+    loadFilterLibrary(jsonPath);
+    auto tStart = std::chrono::high_resolution_clock::now();
 
     // Déclaration des constantes internes
     const std::int64_t NbConfFir = m_firs.size();
@@ -66,188 +43,198 @@ MaximizeRejection::MaximizeRejection(const std::int64_t nbStage, const double ar
     const double AMax = areaMax;
 
     // Déclaration des variables delta
+    std::vector<GRBVar> delta = addVars(NbStage * NbConfFir, 0.0, 1.0, GRB_BINARY, [&](std::size_t k) { return getName("delta", { static_cast<std::int64_t>(k) / NbConfFir, static_cast<std::int64_t>(k) % NbConfFir }); });
     m_var_delta.resize(NbStage);
     for (std::int64_t i = 0; i < NbStage; ++i) {
-        m_var_delta[i].resize(NbConfFir);
-        for (std::int64_t j = 0; j < NbConfFir; ++j) {
-            std::string varName = "delta_" + std::to_string(i) + "_" + std::to_string(j);
-            m_var_delta[i][j] = m_model.addVar(0.0, 1.0, 0.0, GRB_BINARY, varName);
-        }
+        m_var_delta[i].assign(delta.begin() + i * NbConfFir, delta.begin() + (i + 1) * NbConfFir);
     }
 
-    // Déclaration des pi_fir
-    m_var_pi_fir.resize(NbStage);
-    for (std::int64_t i = 0; i < NbStage; ++i) {
-        m_var_pi_fir[i].resize(NbConfFir);
-        for (std::int64_t j = 0; j < NbConfFir; ++j) {
-            std::string varName = "pi_fir_" + std::to_string(i) + "_" + std::to_string(j);
-            m_var_pi_fir[i][j] = m_model.addVar(0.0, GRB_INFINITY, 0.0, GRB_INTEGER, varName);
+    // Déclaration des pi_fir (delta_i_j * pi_fir dans la formulation compacte)
+    if (!m_compact) {
+        std::vector<GRBVar> piFir = addVars(NbStage * NbConfFir, 0.0, GRB_INFINITY, GRB_INTEGER, [&](std::size_t k) { return getName("pi_fir", { static_cast<std::int64_t>(k) / NbConfFir, static_cast<std::int64_t>(k) % NbConfFir }); });
+        m_var_pi_fir.resize(NbStage);
+        for (std::int64_t i = 0; i < NbStage; ++i) {
+            m_var_pi_fir[i].assign(piFir.begin() + i * NbConfFir, piFir.begin() + (i + 1) * NbConfFir);
         }
     }
 
-    // Déclaration des pi_s
-    m_var_pi_s.resize(NbStage);
-    for (std::int64_t i = 0; i < NbStage; ++i) {
-        std::string varName = "pi_s_" + std::to_string(i);
-        m_var_pi_s[i] = m_model.addVar(0.0, PiMax, 0.0, GRB_INTEGER, varName);
+    // Déclaration des pi_s, a, r et pi (r_i est la somme des delta_i_j * r_fir dans la formulation compacte)
+    m_var_pi_s = addVars(NbStage, 0.0, PiMax, GRB_INTEGER, [&](std::size_t i) { return getName("pi_s", { static_cast<std::int64_t>(i) }); });
+    m_var_a = addVars(NbStage, 0.0, GRB_INFINITY, GRB_CONTINUOUS, [&](std::size_t i) { return getName("a", { static_cast<std::int64_t>(i) }); });
+    if (!m_compact) {
+        m_var_r = addVars(NbStage, 0.0, GRB_INFINITY, GRB_CONTINUOUS, [&](std::size_t i) { return getName("r", { static_cast<std::int64_t>(i) }); });
     }
+    m_var_pi = addVars(NbStage, 0.0, PiMax, GRB_INTEGER, [&](std::size_t i) { return getName("pi", { static_cast<std::int64_t>(i) }); });
 
-    // Déclaration des a
-    m_var_a.resize(NbStage);
-    for (std::int64_t i = 0; i < NbStage; ++i) {
-        std::string varName = "a_" + std::to_string(i);
-        m_var_a[i] = m_model.addVar(0.0, GRB_INFINITY, 0.0, GRB_CONTINUOUS, varName);
+    // Déclaration des PI_IN (constante dans la formulation compacte)
+    if (!m_compact) {
+        m_var_PI_IN = m_model.addVar(PiIn, PiIn, 0.0, GRB_INTEGER, getName("PI_IN", {}));
     }
 
-    // Déclaration des r
-    m_var_r.resize(NbStage);
-    for (std::int64_t i = 0; i < NbStage; ++i) {
-        std::string varName = "r_" + std::to_string(i);
-        m_var_r[i] = m_model.addVar(0.0, GRB_INFINITY, 0.0, GRB_CONTINUOUS, varName);
-    }
-
-    // Déclaration des pi
-    m_var_pi.resize(NbStage);
-    for (std::int64_t i = 0; i < NbStage; ++i) {
-        std::string varName = "pi_" + std::to_string(i);
-        m_var_pi[i] = m_model.addVar(0.0, PiMax, 0.0, GRB_INTEGER, varName);
-    }
-
-    // Déclaration des PI_IN
-    {
-        std::string varName = "PI_IN";
-        m_var_PI_IN = m_model.addVar(PiIn, PiIn, 0.0, GRB_INTEGER, varName);
+    // Coefficients de chaque filtre, communs à tous les étages
+    std::vector<double> ones(NbConfFir, 1.0);
+    std::vector<double> minusOnes(NbConfFir, -1.0);
+    std::vector<double> stageOnes(NbStage, 1.0);
+    std::vector<double> areaConst(NbConfFir);
+    std::vector<double> areaPi(NbConfFir);
+    std::vector<double> noise(NbConfFir);
+    std::vector<double> piFirCoeff(NbConfFir);
+    for (std::int64_t j = 0; j < NbConfFir; ++j) {
+        const Fir &currentFir = m_firs[j];
+        areaConst[j] = currentFir.getCardC() * currentFir.getPiC();
+        areaPi[j] = currentFir.getCardC();
+        noise[j] = currentFir.getNoiseLevel();
+        piFirCoeff[j] = currentFir.getPiFir();
     }
 
     // Déclaration des contraintes
     // Un filtre au plus par étage
-    for (std::int64_t i = 0; i < NbStage; ++i) {
-        std::string cstrName = "cstr_nb_fir_" + std::to_string(i);
-        GRBLinExpr expr = 0;
-        for (std::int64_t j = 0; j < NbConfFir; ++j) {
-            expr += m_var_delta[i][j];
+    {
+        std::vector<GRBLinExpr> exprs(NbStage);
+        for (std::int64_t i = 0; i < NbStage; ++i) {
+            exprs[i].addTerms(ones.data(), m_var_delta[i].data(), NbConfFir);
         }
-        m_model.addConstr(expr, GRB_LESS_EQUAL, 1.0, cstrName);
+        addConstrs(exprs, GRB_LESS_EQUAL, 1.0, [&](std::size_t i) { return getName("cstr_nb_fir", { static_cast<std::int64_t>(i) }); });
     }
 
     // Définition de la taille occupée
     for (std::int64_t i = 0; i < NbStage; ++i) {
-        std::string cstrName = "cstr_a_" + std::to_string(i);
+        if (m_compact && i == 0) {
+            // Taille d'entrée connue : la contrainte est linéaire
+            std::vector<double> area(NbConfFir);
+            for (std::int64_t j = 0; j < NbConfFir; ++j) {
+                area[j] = areaConst[j] + areaPi[j] * PiIn;
+            }
+            GRBLinExpr expr = -m_var_a[i];
+            expr.addTerms(area.data(), m_var_delta[i].data(), NbConfFir);
+            m_model.addConstr(expr, GRB_EQUAL, 0.0, getName("cstr_a", { i }));
+            continue;
+        }
+
         GRBQuadExpr expr = 0;
 
         // Affectation de la contrainte à a_i
         expr -= m_var_a[i];
 
-        // Contrainte NON LINEAIRE
-        for (std::int64_t j = 0; j < NbConfFir; ++j) {
-            const Fir &currentFir = m_firs[j];
+        // Contrainte NON LINEAIRE : delta_i_j * card_C * (pi_C + pi_(i-1))
+        std::vector<GRBVar> piPrev(NbConfFir, (i == 0) ? m_var_PI_IN : m_var_pi[i-1]);
+        expr.addTerms(areaConst.data(), m_var_delta[i].data(), NbConfFir);
+        expr.addTerms(areaPi.data(), m_var_delta[i].data(), piPrev.data(), NbConfFir);
 
-            if (i == 0) {
-                expr += m_var_delta[i][j] * currentFir.getCardC() * (currentFir.getPiC() + m_var_PI_IN);
-            }
-            else {
-                expr += m_var_delta[i][j] * currentFir.getCardC() * (currentFir.getPiC() + m_var_pi[i-1]);
-            }
-        }
-        m_model.addQConstr(expr, GRB_EQUAL, 0.0, cstrName);
+        m_model.addQConstr(expr, GRB_EQUAL, 0.0, getName("cstr_a", { i }));
     }
 
     // Définition de la rejection
+    std::vector<GRBLinExpr> rejection(NbStage);
     for (std::int64_t i = 0; i < NbStage; ++i) {
-        std::string cstrName = "cstr_r_" + std::to_string(i);
-        GRBLinExpr expr = 0;
-
-        for (std::int64_t j = 0; j < NbConfFir; ++j) {
-            const Fir &currentFir = m_firs[j];
-            expr += m_var_delta[i][j] * currentFir.getNoiseLevel();
+        rejection[i].addTerms(noise.data(), m_var_delta[i].data(), NbConfFir);
+    }
+    if (!m_compact) {
+        std::vector<GRBLinExpr> exprs = rejection;
+        for (std::int64_t i = 0; i < NbStage; ++i) {
+            // Affectation de la contrainte à r_i
+            exprs[i] -= m_var_r[i];
+            rejection[i] = m_var_r[i];
         }
-
-        // Affectation de la contrainte à r_i
-        expr += -m_var_r[i];
-
-        m_model.addConstr(expr, GRB_EQUAL, 0.0, cstrName);
+        addConstrs(exprs, GRB_EQUAL, 0.0, [&](std::size_t i) { return getName("cstr_r", { static_cast<std::int64_t>(i) }); });
     }
 
     // Contrainte sur la taille en sortie
     for (std::int64_t i = 0; i < NbStage; ++i) {
-        std::string cstrName = "cstr_pi_i_min_" + std::to_string(i);
         GRBLinExpr expr = 0;
 
         // Somme des rejections précédentes (avec shift)
         for (int stage = 0; stage <= i; ++stage) {
-            expr += (1.0/6.0) * m_var_r[stage];
+            expr += (1.0/6.0) * rejection[stage];
 
             // Pour prendre en compte le bit de signe
             expr += 1;
 
 #ifdef FIX_REJECTION_CONSTRAINT
             // Pour prendre en compte le bit de signe - si un filtre est séléctionné
-            GRBLinExpr sum_delta = 0;
-            for (std::int64_t j = 0; j < NbConfFir; ++j) {
-              sum_delta += m_var_delta[i][j];
-            }
-            expr += sum_delta;
+            expr.addTerms(ones.data(), m_var_delta[i].data(), NbConfFir);
 #endif
         }
 
         // Ajout d'un bit de sécurité (Utile ?)
         expr += 1;
 
-        m_model.addConstr(expr, GRB_LESS_EQUAL, m_var_pi[i], cstrName);
+        m_model.addConstr(expr, GRB_LESS_EQUAL, m_var_pi[i], getName("cstr_pi_i_min", { i }));
     }
 
     // Définition de pi_fir
-    for (std::int64_t i = 0; i < NbStage; ++i) {
-        for (std::int64_t j = 0; j < NbConfFir; ++j) {
-            const Fir &currentFir = m_firs[j];
-            std::string cstrName = "cstr_pi_fir_" + std::to_string(i) + "_" + std::to_string(j);
-            m_model.addConstr(m_var_delta[i][j] * currentFir.getPiFir() - m_var_pi_fir[i][j] == 0, cstrName);
+    if (!m_compact) {
+        std::vector<GRBLinExpr> exprs(NbStage * NbConfFir);
+        for (std::int64_t i = 0; i < NbStage; ++i) {
+            for (std::int64_t j = 0; j < NbConfFir; ++j) {
+                GRBLinExpr &expr = exprs[i * NbConfFir + j];
+                expr.addTerms(&piFirCoeff[j], &m_var_delta[i][j], 1);
+                expr.addTerms(&minusOnes[j], &m_var_pi_fir[i][j], 1);
+            }
         }
+        addConstrs(exprs, GRB_EQUAL, 0.0, [&](std::size_t k) { return getName("cstr_pi_fir", { static_cast<std::int64_t>(k) / NbConfFir, static_cast<std::int64_t>(k) % NbConfFir }); });
     }
 
     // Définition de la taille des données en sortie à chaque étage
     for (std::int64_t i = 0; i < NbStage; ++i) {
-        std::string cstrName = "cstr_pi_" + std::to_string(i);
         GRBQuadExpr expr = 0;
 
         // Affectation de la contrainte à pi
         expr -= m_var_pi[i];
 
         // La taille de l'étage = taille en sortie du filtre moins le shift
-        for (std::int64_t j = 0; j < NbConfFir; ++j) {
-            expr += m_var_pi_fir[i][j] - m_var_delta[i][j] * m_var_pi_s[i];
+        std::vector<GRBVar> shift(NbConfFir, m_var_pi_s[i]);
+        if (m_compact) {
+            expr.addTerms(piFirCoeff.data(), m_var_delta[i].data(), NbConfFir);
+        }
+        else {
+            expr.addTerms(ones.data(), m_var_pi_fir[i].data(), NbConfFir);
         }
+        expr.addTerms(minusOnes.data(), m_var_delta[i].data(), shift.data(), NbConfFir);
 
         // Récupération de la taille d'entrée des données
-        if (i == 0) {
+        if (i == 0 && m_compact) {
+            expr += static_cast<double>(PiIn);
+        }
+        else if (i == 0) {
             expr += m_var_PI_IN;
         }
         else {
             expr += m_var_pi[i-1];
         }
 
-        m_model.addQConstr(expr, GRB_EQUAL, 0.0, cstrName);
+        m_model.addQConstr(expr, GRB_EQUAL, 0.0, getName("cstr_pi", { i }));
     }
 
     // Contrainte sur la taille max
     {
-        std::string cstrName = "cstr_A_max";
         GRBLinExpr expr = 0;
-        for (std::int64_t i = 0; i < NbStage; ++i) {
-            expr += m_var_a[i];
-        }
-        m_model.addConstr(expr, GRB_LESS_EQUAL, AMax, cstrName);
+        expr.addTerms(stageOnes.data(), m_var_a.data(), NbStage);
+        m_cstr_limit = m_model.addConstr(expr, GRB_LESS_EQUAL, AMax, getName("cstr_A_max", {}));
     }
 
     // Set the objective
     {
         GRBLinExpr expr = 0;
-        for (int i = 0; i < NbStage; ++i) {
-            expr += m_var_r[i];
+        for (std::int64_t i = 0; i < NbStage; ++i) {
+            expr += rejection[i];
         }
         m_model.setObjective(expr, GRB_MAXIMIZE);
     }
 
+    // Paramètres modifiables sans reconstruire le modèle
+    m_maximizeRejection = true;
+    m_nbStage = NbStage;
+    m_piIn = PiIn;
+    m_constraintLimit = AMax;
+
+    // Point de départ construit par l'heuristique gloutonne
+    setGreedyStart(NbStage, PiIn, true, AMax);
+
+    finishBuild(tStart);
+}
+
+bool MaximizeRejection::solve() {
     auto tStart = std::chrono::high_resolution_clock::now();
 
     // Execute le programme linéaire
@@ -258,22 +245,35 @@ MaximizeRejection::MaximizeRejection(const std::int64_t nbStage, const double ar
     m_computationTime = std::chrono::duration<double>(tEnd-tStart).count();
     std::cout << "Wall clock time passed: " << m_computationTime << "s" << std::endl;
 
+    // Aucune solution trouvée
+    if (m_model.get(GRB_IntAttr_SolCount) == 0) {
+        m_selectedFilters.clear();
+        return false;
+    }
+
+    const std::int64_t NbStage = m_var_delta.size();
+    const std::int64_t NbConfFir = m_firs.size();
+
+    m_selectedFilters.clear();
+    m_areaValue = 0.0;
+    m_rejectionValue = 0.0;
+
     for (int i = 0; i < NbStage; ++i) {
         for (int j = 0; j < NbConfFir; ++j) {
             bool selected = static_cast<bool>(std::round(m_var_delta[i][j].get(GRB_DoubleAttr_X)));
 
             if (selected) {
                 Fir &fir = m_firs[j];
-                double rejection = m_var_r[i].get(GRB_DoubleAttr_X);
+                double rejection = getStageRejection(i);
                 std::int64_t shift = std::round(m_var_pi_s[i].get(GRB_DoubleAttr_X));
                 std::int64_t piIn = 0;
                 if (i == 0) {
-                    piIn = std::round(m_var_PI_IN.get(GRB_DoubleAttr_X));
+                    piIn = m_piIn;
                 }
                 else {
                     piIn = std::round(m_var_pi[i - 1].get(GRB_DoubleAttr_X));
                 }
-                std::int64_t piFir = std::round(m_var_pi_fir[i][j].get(GRB_DoubleAttr_X));
+                std::int64_t piFir = (m_compact) ? fir.getPiFir() : std::round(m_var_pi_fir[i][j].get(GRB_DoubleAttr_X));
                 std::int64_t piOut = std::round(m_var_pi[i].get(GRB_DoubleAttr_X));
 
                 SelectedFilter filter = { i, fir, rejection, shift, piIn, piFir, piOut };
@@ -285,9 +285,84 @@ MaximizeRejection::MaximizeRejection(const std::int64_t nbStage, const double ar
     // Calcul des valeurs importantes
     for (std::int64_t i = 0; i < NbStage; ++i) {
         m_areaValue += m_var_a[i].get(GRB_DoubleAttr_X);
-        m_rejectionValue += m_var_r[i].get(GRB_DoubleAttr_X);
+        m_rejectionValue += getStageRejection(i);
     }
     m_lastPi = m_var_pi[NbStage - 1].get(GRB_DoubleAttr_X);
+
+    return true;
+}
+
+void MaximizeRejection::setStart(const std::vector<SelectedFilter> &filters) {
+    const std::int64_t NbStage = m_var_delta.size();
+
+    // Un départ infaisable serait rejeté par Gurobi, le départ courant est alors gardé
+    const std::vector<SelectedFilter> start = adaptCascade(filters, NbStage, m_piIn, m_maximizeRejection, m_constraintLimit);
+    if (start.empty()) {
+        return;
+    }
+
+    // Les étages absents du départ sont vides
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        for (std::size_t j = 0; j < m_var_delta[i].size(); ++j) {
+            m_var_delta[i][j].set(GRB_DoubleAttr_Start, 0.0);
+            if (!m_compact) {
+                m_var_pi_fir[i][j].set(GRB_DoubleAttr_Start, 0.0);
+            }
+        }
+        m_var_pi_s[i].set(GRB_DoubleAttr_Start, 0.0);
+        m_var_a[i].set(GRB_DoubleAttr_Start, 0.0);
+        if (!m_compact) {
+            m_var_r[i].set(GRB_DoubleAttr_Start, 0.0);
+        }
+    }
+
+    // Un étage vide garde la taille de l'étage précédent
+    double pi = m_piIn;
+    std::size_t index = 0;
+    for (std::int64_t i = 0; i < NbStage; ++i) {
+        if (index < start.size() && start[index].stage == i) {
+            const SelectedFilter &filter = start[index];
+            std::int64_t j = findFir(filter.filter);
+            if (j >= 0) {
+                m_var_delta[i][j].set(GRB_DoubleAttr_Start, 1.0);
+                m_var_pi_s[i].set(GRB_DoubleAttr_Start, filter.shift);
+                m_var_a[i].set(GRB_DoubleAttr_Start, filter.filter.getCardC() * (filter.filter.getPiC() + filter.piIn));
+                if (!m_compact) {
+                    m_var_pi_fir[i][j].set(GRB_DoubleAttr_Start, filter.piFir);
+                    m_var_r[i].set(GRB_DoubleAttr_Start, filter.rejection);
+                }
+                pi = filter.piOut;
+            }
+            ++index;
+        }
+        m_var_pi[i].set(GRB_DoubleAttr_Start, pi);
+    }
+}
+
+bool MaximizeRejection::isUpdatable(const double /* constraintLimit */, const std::int64_t piIn) const {
+    return !m_compact || piIn == m_piIn;
+}
+
+void MaximizeRejection::getStageSelection(std::int64_t stage, std::vector<std::int64_t> &firs, std::vector<GRBVar> &vars) const {
+    firs.clear();
+    vars.clear();
+    for (std::size_t j = 0; j < m_var_delta[stage].size(); ++j) {
+        firs.push_back(j);
+        vars.push_back(m_var_delta[stage][j]);
+    }
+}
+
+double MaximizeRejection::getStageRejection(std::int64_t stage) const {
+    if (!m_compact) {
+        return m_var_r[stage].get(GRB_DoubleAttr_X);
+    }
+
+    // Somme des delta_i_j * r_fir
+    double rejection = 0.0;
+    for (std::size_t j = 0; j < m_var_delta[stage].size(); ++j) {
+        rejection += std::round(m_var_delta[stage][j].get(GRB_DoubleAttr_X)) * m_firs[j].getNoiseLevel();
+    }
+    return rejection;
 }
 
 const std::vector<SelectedFilter> &MaximizeRejection::getSelectedFilters() const {
@@ -298,6 +373,7 @@ void MaximizeRejection::printResults(std::ostream &out) {
     m_model.update();
 
     out << std::endl;
+    out << "Build Time = " << m_buildTime << " seconds" << std::endl;
     out << "Computation Time = " << m_computationTime << " seconds" << std::endl;
 
     out << std::endl;
@@ -319,7 +395,7 @@ void MaximizeRejection::printResults(std::ostream &out) {
         out << "r_i: " << filter.rejection << std::endl;
         out << "r_i/6: " << filter.rejection / 6.0 << std::endl;
         out << "With shift: " << filter.shift << std::endl;
-        out << "Stage rejection: " << m_var_r[i].get(GRB_DoubleAttr_X) << std::endl;
+        out << "Stage rejection: " << getStageRejection(i) << std::endl;
         ++i;
     }
 
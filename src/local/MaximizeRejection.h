@@ -24,6 +24,12 @@
 /**
  * @brief Quadratic program to maximize rejection
  *
+ * The compact formulation substitutes out pi_fir_i_j, r_i and PI_IN: the
+ * size of a filter is delta_i_j * pi_fir, the rejection of a stage is the
+ * sum of delta_i_j * r_fir and the input size of the first stage is a
+ * constant, so the area of this stage is linear. The model has about half
+ * the variables, with the same optimum.
+ *
  * @see QuadraticProgram
  */
 class MaximizeRejection: public QuadraticProgram {
@@ -37,16 +43,34 @@ public:
      * @param areaMax Area constraint
      * @param jsonPath Path to firls filters
      * @param experimentName Name of experiment
+     * @param env Gurobi environnement to share (a new one is created if null)
+     * @param withNames Name the variables and the constraints (for the LP file)
+     * @param compact Use the compact formulation
      */
-    MaximizeRejection(const std::int64_t nbStage, const double areaMax, const std::string &jsonPath, const std::string &experimentName);
+    MaximizeRejection(const std::int64_t nbStage, const double areaMax, const std::string &jsonPath, const std::string &experimentName, GRBEnv *env = nullptr, bool withNames = false, bool compact = false);
 
     /**
-     * @brief Print the result files
-     *
-     * @param out Output stream
+     * @brief Get the optimal selected filters
      */
     const std::vector<SelectedFilter> &getSelectedFilters() const override;
 
+    /**
+     * @brief Optimize the model and read the solution
+     *
+     * @return true if a solution was found
+     */
+    bool solve() override;
+
+    /**
+     * @brief Use a known cascade as MIP start
+     * All the variables are given, the stages without filter are empty.
+     * The cascade is first adapted to the stages of the model (see
+     * adaptCascade()) and ignored if it is not feasible.
+     *
+     * @param filters Selected filters of the known cascade
+     */
+    void setStart(const std::vector<SelectedFilter> &filters) override;
+
     /**
      * @brief Print the results to output stream
      *
@@ -54,14 +78,42 @@ public:
      */
     void printResults(std::ostream &out = std::cout) override;
 
+protected:
+    /**
+     * @brief Check if the built model can be updated to a new problem
+     * The input size of the compact formulation can not change.
+     *
+     * @param constraintLimit New area max or rejection min
+     * @param piIn New input size
+     */
+    bool isUpdatable(const double constraintLimit, const std::int64_t piIn) const override;
+
+    /**
+     * @brief Get the variables delta of a stage
+     *
+     * @param stage Stage
+     * @param firs Index of the filter of each variable
+     * @param vars Variables
+     */
+    void getStageSelection(std::int64_t stage, std::vector<std::int64_t> &firs, std::vector<GRBVar> &vars) const override;
+
 private:
+    /**
+     * @brief Get the rejection of a stage in the current solution
+     *
+     * @param stage Stage
+     */
+    double getStageRejection(std::int64_t stage) const;
+
+private:
+    bool m_compact;
+
     std::vector< std::vector<GRBVar> > m_var_delta;
     std::vector< std::vector<GRBVar> > m_var_pi_fir;
     std::vector<GRBVar> m_var_pi_s;
     std::vector<GRBVar> m_var_a;
     std::vector<GRBVar> m_var_r;
     std::vector<GRBVar> m_var_pi;
-    GRBVar m_var_PI_IN;
 
     std::vector<SelectedFilter> m_selectedFilters;
     double m_areaValue;
@@ -18,10 +18,134 @@
 
 #include "QuadraticProgram.h"
 
-QuadraticProgram::QuadraticProgram(const std::string &experimentName)
-: m_experimentName(experimentName)
-, m_env(GRBEnv())
-, m_model(m_env) {
+#include <iostream>
+
+#include "CascadeVerifier.h"
+
+namespace {
+    const double FeasibilityTol = 1e-6;
+
+    // Rejection gap ignored by the verification (the responses are stored on float)
+    const double VerificationTol = 1e-3;
+}
+
+/**
+ * @brief Lazy constraint callback comparing each incumbent to the response of its coefficients
+ */
+class QuadraticProgram::VerificationCallback: public GRBCallback {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param program Verified model
+     * @param responseCachePath Response cache of the filters of the library
+     */
+    VerificationCallback(const QuadraticProgram &program, const std::string &responseCachePath)
+    : m_program(program)
+    , m_verifier(program.getLibraryPath(), responseCachePath)
+    , m_hasCorrection(false) {
+    }
+
+    /**
+     * @brief Check if the filter bank and the response cache could be opened
+     */
+    bool isOpen() const {
+        return m_verifier.isOpen();
+    }
+
+    /**
+     * @brief Set the variable subtracted from the maximized rejection
+     */
+    void setCorrection(GRBVar correction) {
+        m_correction = correction;
+        m_hasCorrection = true;
+    }
+
+protected:
+    void callback() override {
+        if (where != GRB_CB_MIPSOL) {
+            return;
+        }
+
+        // Filtre sélectionné par chaque étage (-1 pour un étage vide)
+        const std::int64_t nbStage = m_program.m_nbStage;
+        std::vector< std::vector<std::int64_t> > firs(nbStage);
+        std::vector< std::vector<GRBVar> > vars(nbStage);
+        std::vector<std::int64_t> selected(nbStage, -1);
+        std::vector<Fir> cascade;
+        double modelRejection = 0.0;
+        for (std::int64_t i = 0; i < nbStage; ++i) {
+            m_program.getStageSelection(i, firs[i], vars[i]);
+            std::unique_ptr<double[]> values(getSolution(vars[i].data(), vars[i].size()));
+            for (std::size_t k = 0; k < vars[i].size(); ++k) {
+                if (values[k] > 0.5) {
+                    selected[i] = firs[i][k];
+                }
+            }
+
+            if (selected[i] >= 0) {
+                const Fir &fir = m_program.m_firs[selected[i]];
+                cascade.push_back(fir);
+                modelRejection += fir.getNoiseLevel();
+            }
+        }
+
+        double rejection = 0.0;
+        if (!m_verifier.measure(cascade, rejection)) {
+            std::cerr << "QuadraticProgram::VerificationCallback: A filter of the cascade is not in the response cache, it is not verified" << std::endl;
+            return;
+        }
+        std::cout << "Verification: " << cascade.size() << " filters, model rejection " << modelRejection << " dB, response rejection " << rejection << " dB" << std::endl;
+
+        // Nombre de différences avec la cascade vérifiée, nul pour elle seule
+        GRBLinExpr mismatch = 0;
+        for (std::int64_t i = 0; i < nbStage; ++i) {
+            if (selected[i] >= 0) {
+                mismatch += 1.0;
+            }
+            for (std::size_t k = 0; k < vars[i].size(); ++k) {
+                if (selected[i] < 0) {
+                    mismatch += vars[i][k];
+                }
+                else if (firs[i][k] == selected[i]) {
+                    mismatch -= vars[i][k];
+                }
+            }
+        }
+
+        if (m_hasCorrection) {
+            // La réjection de cette cascade est ramenée à celle de sa réponse
+            const double gap = modelRejection - rejection;
+            if (gap > VerificationTol && getSolution(m_correction) < gap - VerificationTol) {
+                addLazy(m_correction + gap * mismatch, GRB_GREATER_EQUAL, gap);
+            }
+        }
+        else if (rejection < m_program.m_constraintLimit - VerificationTol) {
+            // Cascade interdite : sa réponse n'atteint pas la réjection min
+            addLazy(mismatch, GRB_GREATER_EQUAL, 1.0);
+        }
+    }
+
+private:
+    const QuadraticProgram &m_program;
+    CascadeVerifier m_verifier;
+    GRBVar m_correction;
+    bool m_hasCorrection;
+};
+
+QuadraticProgram::QuadraticProgram(const std::string &experimentName, GRBEnv *env, bool withNames)
+: CascadeSolver(experimentName)
+, m_ownEnv((env == nullptr) ? new GRBEnv() : nullptr)
+, m_model((env == nullptr) ? *m_ownEnv : *env)
+, m_maximizeRejection(true)
+, m_nbStage(0)
+, m_piIn(0)
+, m_constraintLimit(0.0)
+, m_withNames(withNames)
+, m_buildTime(0.0) {
+}
+
+QuadraticProgram::~QuadraticProgram() {
 }
 
 void QuadraticProgram::printDebugFiles(std::ostream &out) {
@@ -33,41 +157,132 @@ void QuadraticProgram::printDebugFiles(std::ostream &out) {
     m_model.write(filename);
 }
 
-void QuadraticProgram::printResults(const std::string &filename) {
-    std::ofstream file(m_experimentName + "/" + filename);
-    if(!file.good()) {
-        std::cerr << "QuadraticProgram::printResults(): open '" << m_experimentName << "/" << filename << "': failed" << std::endl;
-        return;
+bool QuadraticProgram::updateLimit(const double constraintLimit, const std::int64_t piIn) {
+    if (!isUpdatable(constraintLimit, piIn)) {
+        return false;
+    }
+
+    // Seuls le second membre de la contrainte et les bornes de PI_IN changent
+    m_cstr_limit.set(GRB_DoubleAttr_RHS, constraintLimit);
+    if (piIn != m_piIn) {
+        m_var_PI_IN.set(GRB_DoubleAttr_LB, piIn);
+        m_var_PI_IN.set(GRB_DoubleAttr_UB, piIn);
+    }
+
+    // La cascade précédente reste un point de départ si elle respecte la nouvelle limite
+    const std::vector<SelectedFilter> &previous = getSelectedFilters();
+    bool feasible = (piIn == m_piIn && !previous.empty());
+    if (feasible) {
+        double area = 0.0;
+        double rejection = 0.0;
+        for (const SelectedFilter &filter: previous) {
+            area += filter.filter.getCardC() * (filter.filter.getPiC() + filter.piIn);
+            rejection += filter.rejection;
+        }
+        feasible = (m_maximizeRejection) ? (area <= constraintLimit + FeasibilityTol) : (rejection >= constraintLimit - FeasibilityTol);
+    }
+
+    m_constraintLimit = constraintLimit;
+    m_piIn = piIn;
+
+    if (feasible) {
+        setStart(previous);
+    }
+    else {
+        setGreedyStart(m_nbStage, m_piIn, m_maximizeRejection, m_constraintLimit);
     }
 
-    printResults(file);
+    return true;
+}
+
+std::int64_t QuadraticProgram::getPiIn() const {
+    return m_piIn;
+}
+
+double QuadraticProgram::getBuildTime() const {
+    return m_buildTime;
 }
 
-void QuadraticProgram::loadFirConfiguration(const std::string &filename, const std::string &method) {
-    // Open the file
-    std::ifstream file(filename, std::ios::binary);
-    if (file.fail()) {
-        std::cerr << "QuadraticProgram::loadFirConfiguration: The file '" << filename << "' is missing" << std::endl;
-        std::exit(-1);
+bool QuadraticProgram::setVerification(const std::string &responseCachePath) {
+    m_verification.reset(new VerificationCallback(*this, responseCachePath));
+    if (!m_verification->isOpen()) {
+        std::cerr << "QuadraticProgram::setVerification: The filter library '" << getLibraryPath() << "' is not a filter bank or the response cache '" << responseCachePath << "' is missing" << std::endl;
+        m_verification.reset();
+        return false;
     }
 
-    // Read the file until eof
-    for (;;) {
-        std::uint16_t nob = 0;
-        std::uint16_t coeff = 0;
-        double rejection = 0.0;
+    // Pénalité de l'objectif, fixée par les coupes de chaque cascade vérifiée
+    if (m_maximizeRejection) {
+        m_verification->setCorrection(m_model.addVar(0.0, GRB_INFINITY, -1.0, GRB_CONTINUOUS, "verification_correction"));
+    }
 
-        // Read the values
-        file.read(reinterpret_cast<char*>(&nob), sizeof(std::uint16_t));
-        file.read(reinterpret_cast<char*>(&coeff), sizeof(std::uint16_t));
-        file.read(reinterpret_cast<char*>(&rejection), sizeof(double));
+    m_model.set(GRB_IntParam_LazyConstraints, 1);
+    m_model.setCallback(m_verification.get());
 
-        // If the end of file is reached
-        if (file.eof()) {
-            break;
+    return true;
+}
+
+bool QuadraticProgram::isUpdatable(const double /* constraintLimit */, const std::int64_t /* piIn */) const {
+    return true;
+}
+
+std::vector<GRBVar> QuadraticProgram::addVars(std::size_t count, double lb, double ub, char type, const std::function<std::string(std::size_t)> &name) {
+    if (count == 0) {
+        return std::vector<GRBVar>();
+    }
+
+    std::vector<double> lbs(count, lb);
+    std::vector<double> ubs(count, ub);
+    std::vector<char> types(count, type);
+    std::unique_ptr<std::string[]> names;
+    if (m_withNames) {
+        names.reset(new std::string[count]);
+        for (std::size_t k = 0; k < count; ++k) {
+            names[k] = name(k);
         }
+    }
 
-        // Add fir configuration
-        m_firs.emplace_back(method, coeff, nob, rejection);
+    // Gurobi alloue le tableau des variables, à libérer par l'appelant
+    std::unique_ptr<GRBVar[]> vars(m_model.addVars(lbs.data(), ubs.data(), nullptr, types.data(), names.get(), static_cast<int>(count)));
+    return std::vector<GRBVar>(vars.get(), vars.get() + count);
+}
+
+void QuadraticProgram::addConstrs(const std::vector<GRBLinExpr> &exprs, char sense, double rhs, const std::function<std::string(std::size_t)> &name) {
+    const std::size_t count = exprs.size();
+    if (count == 0) {
+        return;
     }
+
+    std::vector<char> senses(count, sense);
+    std::vector<double> rhss(count, rhs);
+    std::unique_ptr<std::string[]> names;
+    if (m_withNames) {
+        names.reset(new std::string[count]);
+        for (std::size_t k = 0; k < count; ++k) {
+            names[k] = name(k);
+        }
+    }
+
+    std::unique_ptr<GRBConstr[]> constrs(m_model.addConstrs(exprs.data(), senses.data(), rhss.data(), names.get(), static_cast<int>(count)));
+}
+
+std::string QuadraticProgram::getName(const std::string &prefix, std::initializer_list<std::int64_t> indexes) const {
+    if (!m_withNames) {
+        return std::string();
+    }
+
+    std::string name = prefix;
+    for (std::int64_t index: indexes) {
+        name += "_" + std::to_string(index);
+    }
+    return name;
+}
+
+void QuadraticProgram::finishBuild(std::chrono::high_resolution_clock::time_point tStart) {
+    m_model.update();
+
+    auto tEnd = std::chrono::high_resolution_clock::now();
+
+    m_buildTime = std::chrono::duration<double>(tEnd-tStart).count();
+    std::cout << "Model build time: " << m_buildTime << "s (" << m_model.get(GRB_IntAttr_NumVars) << " variables, " << m_model.get(GRB_IntAttr_NumConstrs) + m_model.get(GRB_IntAttr_NumQConstrs) << " constraints)" << std::endl;
 }
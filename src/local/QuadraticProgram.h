@@ -19,27 +19,14 @@
 #ifndef QUADRATIC_PROGRAM_H
 #define QUADRATIC_PROGRAM_H
 
-#include <cinttypes>
+#include <chrono>
+#include <functional>
+#include <memory>
 #include <vector>
 
 #include <gurobi_c++.h>
 
-#include "Fir.h"
-
-/**
- * @brief Structure to handle the filter selection
- *
- * @see Fir
- */
-struct SelectedFilter {
-    std::int64_t stage;     /*!< Indicate the stage  */
-    Fir filter;             /*!< Describe the selected filter */
-    double rejection;       /*!< Indicate the total rejection */
-    std::int64_t shift;     /*!< Indicate the number of shited bits */
-    std::int64_t piIn;      /*!< Indicate the number of input bits */
-    std::int64_t piFir;     /*!< Indicate the number of bits added by the filter */
-    std::int64_t piOut;     /*!< Indicate the number of output bits */
-};
+#include "CascadeSolver.h"
 
 /**
  * @brief Interface of any instances of quadratic model
@@ -47,65 +34,149 @@ struct SelectedFilter {
  * @see MaximizeRejection
  * @see MinimizeArea
  */
-class QuadraticProgram {
+class QuadraticProgram: public CascadeSolver {
 public:
     /**
      * @brief Constructor
      *
      * @param experimentName Name used to create some folders and files
+     * @param env Gurobi environnement to share (a new one is created if null)
+     * @param withNames Name the variables and the constraints (for the LP file)
      */
-    QuadraticProgram(const std::string &experimentName);
+    QuadraticProgram(const std::string &experimentName, GRBEnv *env = nullptr, bool withNames = false);
 
     /**
-     * @brief Default destructor
+     * @brief Destructor
      */
-    virtual ~QuadraticProgram() {}
-
-    /**
-     * @brief Get the selected filters
-     */
-    virtual const std::vector<SelectedFilter>& getSelectedFilters() const = 0;
+    ~QuadraticProgram() override;
 
     /**
      * @brief Print the debug files
+     * Without names, the LP file uses the default names of Gurobi.
      *
      * @param out Output stream
      */
-    virtual void printDebugFiles(std::ostream &out = std::cout);
+    void printDebugFiles(std::ostream &out = std::cout) override;
 
     /**
-     * @brief Print the result files
+     * @brief Change the constraint limit and the input size of the built model
+     * Only the right-hand side of the area max or rejection min constraint
+     * and the bounds of PI_IN are modified, the next call to solve() starts
+     * from the previous cascade if it is still feasible, or from the greedy
+     * cascade.
      *
-     * @param out Output stream
+     * @param constraintLimit New area max or rejection min
+     * @param piIn New input size (16 for PRN input, 7 for ADC input)
+     * @return false if the model can not represent the new problem and must be rebuilt
      */
-    virtual void printResults(std::ostream &out = std::cout) = 0;
+    bool updateLimit(const double constraintLimit, const std::int64_t piIn);
 
     /**
-     * @brief Print the result into indicate file
+     * @brief Get the input size of the first stage
+     */
+    std::int64_t getPiIn() const;
+
+    /**
+     * @brief Get the time spent to build the model, in seconds
+     */
+    double getBuildTime() const;
+
+    /**
+     * @brief Verify each new incumbent with the response of its quantized coefficients
+     * A lazy constraint callback computes the rejection of each cascade found
+     * by Gurobi from the response cache (see CascadeVerifier). When it is
+     * lower than the sum of the rejections of the filters, a maximized
+     * rejection is corrected for this exact cascade by a penalty variable of
+     * the objective, and a cascade under the rejection min is cut off. The
+     * optimum is then the best cascade according to the verified rejections.
+     * The filter library must be a filter bank.
      *
-     * @param filename Path of output file
+     * @param responseCachePath Response cache of the filters of the library
+     * @return false if the filter bank or the response cache can not be opened
      */
-    void printResults(const std::string &filename);
+    bool setVerification(const std::string &responseCachePath);
 
 protected:
     /**
-     * @brief Load FIR confiuration form binary file
-     * The format of binary file is :
-     * 1) uint16 (number of coefficients)
-     * 2) uint16 (number of bit for each coefficient)
-     * 3) double (noise rejection)
+     * @brief Check if the built model can be updated to a new problem
+     * By default, all the limits and input sizes are allowed.
+     *
+     * @param constraintLimit New area max or rejection min
+     * @param piIn New input size
+     */
+    virtual bool isUpdatable(const double constraintLimit, const std::int64_t piIn) const;
+
+    /**
+     * @brief Get the variables selecting the filters of a stage
+     * The filter j is selected at the stage if the sum of its variables is 1.
      *
-     * @param filename Binary filename
-     * @param method Algorithm used to create the coefficients
+     * @param stage Stage
+     * @param firs Index of the filter of each variable
+     * @param vars Variables
      */
-    void loadFirConfiguration(const std::string &filename, const std::string &method);
+    virtual void getStageSelection(std::int64_t stage, std::vector<std::int64_t> &firs, std::vector<GRBVar> &vars) const = 0;
+
+    /**
+     * @brief Add a block of variables with the same bounds and type
+     * The variables are created by a single call to Gurobi. The name function
+     * is only called if the model is named.
+     *
+     * @param count Number of variables
+     * @param lb Lower bound
+     * @param ub Upper bound
+     * @param type Type of the variables
+     * @param name Name of the k-th variable
+     * @return The variables
+     */
+    std::vector<GRBVar> addVars(std::size_t count, double lb, double ub, char type, const std::function<std::string(std::size_t)> &name);
+
+    /**
+     * @brief Add a block of linear constraints with the same sense and right-hand side
+     * The constraints are created by a single call to Gurobi. The name
+     * function is only called if the model is named.
+     *
+     * @param exprs Left-hand side of each constraint
+     * @param sense Sense of the constraints
+     * @param rhs Right-hand side
+     * @param name Name of the k-th constraint
+     */
+    void addConstrs(const std::vector<GRBLinExpr> &exprs, char sense, double rhs, const std::function<std::string(std::size_t)> &name);
+
+    /**
+     * @brief Get the name of a variable or a constraint
+     *
+     * @param prefix Prefix of the name
+     * @param indexes Indexes appended to the prefix, separated by '_'
+     * @return The name, or an empty string if the model is not named
+     */
+    std::string getName(const std::string &prefix, std::initializer_list<std::int64_t> indexes) const;
+
+    /**
+     * @brief Apply the pending modifications and print the build time
+     * The update of the model is counted in the build time and not in the
+     * solve time.
+     *
+     * @param tStart Start of the construction, after the load of the library
+     */
+    void finishBuild(std::chrono::high_resolution_clock::time_point tStart);
 
 protected:
-    const std::string m_experimentName;   /*!< Experiment name used to create directory and files */
-    GRBEnv m_env;                         /*!< Gurobi environnement */
+    std::unique_ptr<GRBEnv> m_ownEnv;     /*!< Gurobi environnement if not shared */
     GRBModel m_model;                     /*!< Gurobi model */
 
-    std::vector<Fir> m_firs;              /*!< Storage for all filter configurations */
+    GRBConstr m_cstr_limit;               /*!< Area max or rejection min constraint */
+    GRBVar m_var_PI_IN;                   /*!< Input size of the first stage */
+    bool m_maximizeRejection;             /*!< Criterion of the model */
+    std::int64_t m_nbStage;               /*!< Total stage */
+    std::int64_t m_piIn;                  /*!< Input size of the first stage */
+    double m_constraintLimit;             /*!< Area max or rejection min */
+    bool m_withNames;                     /*!< Name the variables and the constraints */
+    double m_buildTime;                   /*!< Time spent to build the model */
+
+private:
+    class VerificationCallback;
+
+    std::unique_ptr<VerificationCallback> m_verification;
 };
 
 #endif // QUADRATIC_PROGRAM_H
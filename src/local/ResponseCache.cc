@@ -0,0 +1,232 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "ResponseCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include "Fft.h"
+
+namespace {
+    const char Magic[8] = { 'F', 'I', 'R', 'R', 'E', 'S', 'P', '\0' };
+
+    // Alignment of the responses in the file, for the vector loads
+    constexpr std::uint64_t ResponseAlignment = 64;
+}
+
+ResponseCache::ResponseCache(const std::string &path)
+: m_file(path)
+, m_header(nullptr)
+, m_keys(nullptr)
+, m_responses(nullptr)
+, m_open(false) {
+    if (!m_file.isOpen()) {
+        return;
+    }
+    m_open = validate();
+}
+
+bool ResponseCache::write(const std::string &path, std::size_t points, const std::vector< std::vector<std::int64_t> > &filters) {
+    if (points == 0 || (points & (points - 1)) != 0) {
+        std::cerr << "ResponseCache::write: The number of points must be a power of two" << std::endl;
+        return false;
+    }
+
+    // Une seule réponse par contenu de coefficients
+    std::vector< std::pair<Key, std::size_t> > keys;
+    for (std::size_t i = 0; i < filters.size(); ++i) {
+        if (filters[i].empty()) {
+            continue;
+        }
+        Key key;
+        std::memset(&key, 0, sizeof(key));
+        key.hash = hashTaps(filters[i]);
+        key.nbTap = filters[i].size();
+        keys.emplace_back(key, i);
+    }
+    std::stable_sort(keys.begin(), keys.end(), [](const std::pair<Key, std::size_t> &a, const std::pair<Key, std::size_t> &b) {
+        return std::make_pair(a.first.hash, a.first.nbTap) < std::make_pair(b.first.hash, b.first.nbTap);
+    });
+    keys.erase(std::unique(keys.begin(), keys.end(), [&filters](const std::pair<Key, std::size_t> &a, const std::pair<Key, std::size_t> &b) {
+        return filters[a.second] == filters[b.second];
+    }), keys.end());
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.nbPoint = points;
+    header.nbResponse = keys.size();
+    header.keyOffset = sizeof(Header);
+    header.responseOffset = (header.keyOffset + keys.size() * sizeof(Key) + ResponseAlignment - 1) / ResponseAlignment * ResponseAlignment;
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const std::pair<Key, std::size_t> &key: keys) {
+        file.write(reinterpret_cast<const char *>(&key.first), sizeof(Key));
+    }
+    const std::vector<char> padding(header.responseOffset - header.keyOffset - keys.size() * sizeof(Key), 0);
+    file.write(padding.data(), padding.size());
+
+    // Mêmes points que freqz(b, 1, N) : la première moitié d'une FFT de taille 2N
+    const Fft fft(2 * points);
+    std::vector< std::complex<double> > buffer(2 * points);
+    std::vector<float> response(points);
+    for (const std::pair<Key, std::size_t> &key: keys) {
+        const std::vector<std::int64_t> &taps = filters[key.second];
+        std::fill(buffer.begin(), buffer.end(), 0.0);
+        for (std::size_t k = 0; k < taps.size(); ++k) {
+            buffer[k % buffer.size()] += static_cast<double>(taps[k]);
+        }
+        fft.transform(buffer);
+
+        const double reference = std::abs(buffer[0]);
+        for (std::size_t m = 0; m < points; ++m) {
+            const float level = 20.0 * std::log10(std::abs(buffer[m]) / reference);
+            // Les zéros de la réponse (et les NaN d'un gain nul) sont ramenés au plancher
+            response[m] = (level > MinLevel) ? level : MinLevel;
+        }
+        file.write(reinterpret_cast<const char *>(response.data()), points * sizeof(float));
+    }
+
+    if (!file.good()) {
+        std::cerr << "ResponseCache::write: Write '" << path << "': failed" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+std::uint64_t ResponseCache::hashTaps(const std::vector<std::int64_t> &taps) {
+    // FNV-1a sur les coefficients en int64
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (std::int64_t tap: taps) {
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&tap);
+        for (std::size_t i = 0; i < sizeof(tap); ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+bool ResponseCache::isOpen() const {
+    return m_open;
+}
+
+std::size_t ResponseCache::getNbPoint() const {
+    return m_header->nbPoint;
+}
+
+std::size_t ResponseCache::getNbResponse() const {
+    return m_header->nbResponse;
+}
+
+const float *ResponseCache::find(const std::vector<std::int64_t> &taps) const {
+    const std::pair<std::uint64_t, std::uint64_t> target(hashTaps(taps), taps.size());
+    const Key *last = m_keys + m_header->nbResponse;
+    const Key *it = std::lower_bound(m_keys, last, target, [](const Key &key, const std::pair<std::uint64_t, std::uint64_t> &value) {
+        return std::pair<std::uint64_t, std::uint64_t>(key.hash, key.nbTap) < value;
+    });
+    if (it == last || it->hash != target.first || it->nbTap != target.second) {
+        return nullptr;
+    }
+
+    return m_responses + (it - m_keys) * m_header->nbPoint;
+}
+
+bool ResponseCache::getCascadeResponse(const std::vector< std::vector<std::int64_t> > &stages, std::vector<float> &response) const {
+    const std::size_t points = m_header->nbPoint;
+    response.assign(points, 0.0f);
+
+    float *sum = response.data();
+    for (const std::vector<std::int64_t> &taps: stages) {
+        const float *stage = find(taps);
+        if (stage == nullptr) {
+            return false;
+        }
+
+        // Produit des réponses = somme des niveaux en dB
+        for (std::size_t m = 0; m < points; ++m) {
+            sum[m] += stage[m];
+        }
+    }
+
+    return true;
+}
+
+double ResponseCache::measureRejection(const std::vector<float> &response, double fc) {
+    const std::int64_t points = response.size();
+
+    // Index de la fin de la bande passante et du début de la bande coupée
+    const std::int64_t indexBand = std::llround((fc - 0.1) * points);
+    const std::int64_t indexTail = std::llround((fc + 0.1) * points);
+
+    double bandMax = -std::numeric_limits<double>::infinity();
+    double bandMin = std::numeric_limits<double>::infinity();
+    double tailMax = -std::numeric_limits<double>::infinity();
+    for (std::int64_t m = 0; m < points; ++m) {
+        if (m < indexBand) {
+            bandMax = std::max<double>(bandMax, response[m]);
+            bandMin = std::min<double>(bandMin, response[m]);
+        }
+        if (m >= indexTail) {
+            tailMax = std::max<double>(tailMax, response[m]);
+        }
+    }
+
+    return -(bandMax - bandMin) - tailMax;
+}
+
+bool ResponseCache::validate() {
+    const std::uint64_t size = m_file.getSize();
+    const char *data = m_file.getData();
+    if (size < sizeof(Header)) {
+        return false;
+    }
+
+    m_header = reinterpret_cast<const Header *>(data);
+    if (std::memcmp(m_header->magic, Magic, sizeof(Magic)) != 0 || m_header->version != Version || m_header->nbPoint == 0) {
+        return false;
+    }
+
+    // Chaque table doit être alignée et contenue dans le fichier
+    const std::uint64_t responseSize = m_header->nbPoint * sizeof(float);
+    if (m_header->keyOffset % alignof(Key) != 0 || m_header->keyOffset > size || m_header->nbResponse > (size - m_header->keyOffset) / sizeof(Key)
+        || m_header->responseOffset % alignof(float) != 0 || m_header->responseOffset > size || m_header->nbResponse > (size - m_header->responseOffset) / responseSize) {
+        return false;
+    }
+
+    m_keys = reinterpret_cast<const Key *>(data + m_header->keyOffset);
+    m_responses = reinterpret_cast<const float *>(data + m_header->responseOffset);
+
+    // La recherche par dichotomie suppose les clés triées
+    for (std::size_t i = 1; i < m_header->nbResponse; ++i) {
+        if (std::make_pair(m_keys[i].hash, m_keys[i].nbTap) < std::make_pair(m_keys[i - 1].hash, m_keys[i - 1].nbTap)) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,161 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+/**
+ * @brief Read only view of a cache of quantized frequency responses
+ * Each response is the magnitude of freqz(b, 1, N) in dB, normalized by its
+ * value at the null frequency, on the N points of the grid of the cache. The
+ * responses are addressed by the content of their coefficients, so the cache
+ * does not depend on the names of the filters nor on their library. The file
+ * is mapped in memory (native endianness):
+ * - a header of 64 bytes (magic, version, number of points and of responses);
+ * - the keys (hash and number of coefficients), sorted by hash;
+ * - the responses (N float each, aligned on 64 bytes), in the order of the keys.
+ * The normalized response of a cascade is the sum of the responses of its
+ * stages, the shifts only change its gain.
+ */
+class ResponseCache {
+public:
+    /**
+     * @brief Current version of the format
+     */
+    static constexpr std::uint32_t Version = 1;
+
+    /**
+     * @brief Level of the null points of a response (dB)
+     */
+    static constexpr float MinLevel = -400.0f;
+
+    /**
+     * @brief Constructor
+     * The cache is not opened if its header, its version or one of its tables
+     * is not valid.
+     *
+     * @param path Path of the cache
+     */
+    ResponseCache(const std::string &path);
+
+    /**
+     * @brief Compute the responses of filters and write them in a cache
+     * The filters with the same coefficients are stored once.
+     *
+     * @param path Path of the cache
+     * @param points Number of points of each response (power of two)
+     * @param filters Coefficients of each filter
+     * @return false if the number of points is not valid or the file can not be written
+     */
+    static bool write(const std::string &path, std::size_t points, const std::vector< std::vector<std::int64_t> > &filters);
+
+    /**
+     * @brief Hash of the coefficients of a filter, used as its address
+     *
+     * @param taps Coefficients of the filter
+     */
+    static std::uint64_t hashTaps(const std::vector<std::int64_t> &taps);
+
+    /**
+     * @brief Check if the cache could be opened
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Get the number of points of each response
+     */
+    std::size_t getNbPoint() const;
+
+    /**
+     * @brief Get the number of responses
+     */
+    std::size_t getNbResponse() const;
+
+    /**
+     * @brief Find the response of a filter
+     *
+     * @param taps Coefficients of the filter
+     * @return The response (getNbPoint() values in dB), or null if it is not in the cache
+     */
+    const float *find(const std::vector<std::int64_t> &taps) const;
+
+    /**
+     * @brief Compute the normalized response of a cascade
+     * The responses of the stages are added by a loop written to be
+     * vectorized by the compiler (see LP_NATIVE).
+     *
+     * @param stages Coefficients of each stage
+     * @param response Response of the cascade (getNbPoint() values in dB)
+     * @return false if the response of a stage is not in the cache
+     */
+    bool getCascadeResponse(const std::vector< std::vector<std::int64_t> > &stages, std::vector<float> &response) const;
+
+    /**
+     * @brief Apply the rejection criterion of the filter libraries to a response
+     * The passband ends at fc - 0.1 and the stopband starts at fc + 0.1
+     * (normalized frequencies): the rejection is the attenuation of the
+     * stopband minus the ripple of the passband.
+     *
+     * @param response Normalized response in dB
+     * @param fc Cutoff frequency
+     */
+    static double measureRejection(const std::vector<float> &response, double fc);
+
+private:
+    /**
+     * @brief Key of a response
+     */
+    struct Key {
+        std::uint64_t hash;         /*!< Hash of the coefficients */
+        std::uint32_t nbTap;        /*!< Number of coefficients */
+        std::uint32_t reserved;     /*!< Unused, zero */
+    };
+
+    /**
+     * @brief Header of the cache
+     */
+    struct Header {
+        char magic[8];                  /*!< "FIRRESP" */
+        std::uint32_t version;          /*!< Version of the format */
+        std::uint32_t nbPoint;          /*!< Number of points of each response */
+        std::uint64_t nbResponse;       /*!< Number of responses */
+        std::uint64_t keyOffset;        /*!< Offset of the keys */
+        std::uint64_t responseOffset;   /*!< Offset of the responses */
+        std::uint64_t reserved[3];      /*!< Unused, zero */
+    };
+
+    /**
+     * @brief Check the header and the tables of the mapped file
+     */
+    bool validate();
+
+private:
+    MappedFile m_file;
+    const Header *m_header;
+    const Key *m_keys;
+    const float *m_responses;
+    bool m_open;
+};
+
+#endif // RESPONSE_CACHE_H
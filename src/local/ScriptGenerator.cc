@@ -18,9 +18,14 @@
 
 #include "ScriptGenerator.h"
 
-#include "QuadraticProgram.h"
+#include <algorithm>
+#include <fstream>
+#include <vector>
 
-void ScriptGenerator::generateDeployScript(const QuadraticProgram &milp, const std::string &experimentName, const std::string dtboType) {
+#include "CascadeSolver.h"
+#include "FilterBank.h"
+
+void ScriptGenerator::generateDeployScript(const CascadeSolver &milp, const std::string &experimentName, const std::string dtboType) {
     std::string scriptFilename = experimentName + "/" + experimentName + ".sh";
 
     std::ofstream file = createShellFile(scriptFilename);
@@ -70,7 +75,7 @@ void ScriptGenerator::generateDeployScript(const QuadraticProgram &milp, const s
     safeShellCommand(file, "scp root@redpitaya:~/data_fir.bin " + experimentName + "/data_" + std::to_string(nbStage) + "_fir.bin");
 }
 
-void ScriptGenerator::generateSimulationScript(const QuadraticProgram &milp, const std::string &experimentName) {
+void ScriptGenerator::generateSimulationScript(const CascadeSolver &milp, const std::string &experimentName) {
     std::string scriptFilename = experimentName + "/" + experimentName + ".m";
 
     std::ofstream file = createOctaveFile(scriptFilename);
@@ -143,6 +148,182 @@ void ScriptGenerator::generateSimulationScript(const QuadraticProgram &milp, con
     file << std::endl;
 }
 
+bool ScriptGenerator::generateSimulatorSource(const CascadeSolver &milp, const std::string &experimentName) {
+    const std::vector<SelectedFilter> &filters = milp.getSelectedFilters();
+
+    // Lecture des coefficients de chaque étage, dans l'archive si la bibliothèque en est une
+    std::vector< std::vector<std::int64_t> > coeffs;
+    if (FilterBank::isFilterBank(milp.getLibraryPath())) {
+        FilterBank bank(milp.getLibraryPath());
+        for (const SelectedFilter &filter: filters) {
+            const std::int64_t index = bank.isOpen() ? bank.find(filter.filter.getFilterName()) : -1;
+            if (index < 0) {
+                std::cerr << "ScriptGenerator::generateSimulatorSource: The filter '" << filter.filter.getFilterName() << "' is not in the filter bank, the simulator is not generated" << std::endl;
+                return false;
+            }
+            const std::int32_t *taps = bank.getTaps(index);
+            coeffs.emplace_back(taps, taps + bank.getEntry(index).cardC);
+        }
+    }
+    else {
+        for (const SelectedFilter &filter: filters) {
+            std::ifstream coeffFile(filter.filter.getFilterName());
+            if (coeffFile.fail()) {
+                std::cerr << "ScriptGenerator::generateSimulatorSource: The coefficient file '" << filter.filter.getFilterName() << "' is missing, the simulator is not generated" << std::endl;
+                return false;
+            }
+
+            coeffs.emplace_back();
+            std::int64_t coeff = 0;
+            while (coeffFile >> coeff) {
+                coeffs.back().push_back(coeff);
+            }
+            if (coeffs.back().empty()) {
+                std::cerr << "ScriptGenerator::generateSimulatorSource: The coefficient file '" << filter.filter.getFilterName() << "' is empty, the simulator is not generated" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    std::string sourceFilename = experimentName + "/simulator/simulator.cc";
+    std::ofstream file(sourceFilename);
+    if (!file.good()) {
+        std::cerr << "ScriptGenerator::generateSimulatorSource: Open " << sourceFilename << " file: failed" << std::endl;
+        std::exit(1);
+    }
+
+    file << "// Bit exact simulator of the cascade of " << experimentName << ", generated by fir-solver" << std::endl;
+    file << "#include <array>" << std::endl;
+    file << "#include <cstdint>" << std::endl;
+    file << "#include <cstdio>" << std::endl;
+    file << "#include <cstring>" << std::endl;
+    file << "#include <vector>" << std::endl;
+    file << std::endl;
+    file << "namespace {" << std::endl;
+    file << "    constexpr std::size_t BlockSize = 1 << 16;" << std::endl;
+    file << "    constexpr std::size_t NbStage = " << filters.size() << ";" << std::endl;
+
+    // Un noyau par étage : y[n] = (sum c[k] * x[n - k]) >> shift, avec s[delay] = x[n]
+    for (std::size_t s = 0; s < filters.size(); ++s) {
+        const SelectedFilter &filter = filters[s];
+        const std::vector<std::int64_t> &taps = coeffs[s];
+        const std::size_t delay = taps.size() - 1;
+        const bool symmetric = std::equal(taps.begin(), taps.end(), taps.rbegin());
+
+        file << std::endl;
+        file << "    // Stage " << s << ": " << filter.filter.getFilterName() << ", shift " << filter.shift << ", pi_out " << filter.piOut << std::endl;
+        file << "    constexpr std::array<std::int64_t, " << taps.size() << "> Taps" << s << " = {";
+        for (std::size_t k = 0; k < taps.size(); ++k) {
+            file << (k == 0 ? " " : ", ") << taps[k];
+        }
+        file << " };" << std::endl;
+        file << "    constexpr std::size_t Delay" << s << " = " << delay << ";" << std::endl;
+        file << "    constexpr int Shift" << s << " = " << std::min<std::int64_t>(filter.shift, 63) << ";" << std::endl;
+        file << std::endl;
+        file << "    void stage" << s << "(const std::int64_t *x, std::int64_t *y, std::size_t length) {" << std::endl;
+        file << "        for (std::size_t n = 0; n < length; ++n) {" << std::endl;
+        file << "            const std::int64_t *s = x + n;" << std::endl;
+        file << "            y[n] = (0";
+        const std::size_t nbTerm = symmetric ? (taps.size() + 1) / 2 : taps.size();
+        for (std::size_t k = 0; k < nbTerm; ++k) {
+            if (taps[k] == 0) {
+                continue;
+            }
+            file << std::endl << "                + Taps" << s << "[" << k << "] * ";
+            if (symmetric && k != delay - k) {
+                file << "(s[" << delay - k << "] + s[" << k << "])";
+            }
+            else {
+                file << "s[" << delay - k << "]";
+            }
+        }
+        file << ") >> Shift" << s << ";" << std::endl;
+        file << "        }" << std::endl;
+        file << "    }" << std::endl;
+    }
+    file << "}" << std::endl;
+    file << std::endl;
+
+    // Boucle de simulation par blocs, chaque étage garde ses derniers échantillons
+    file << "int main(int argc, char *argv[]) {" << std::endl;
+    file << "    if (argc != 3) {" << std::endl;
+    file << "        std::fprintf(stderr, \"Usage: %s RAW_DATA_FILE OUTPUT_FILE\\n\", argv[0]);" << std::endl;
+    file << "        return 1;" << std::endl;
+    file << "    }" << std::endl;
+    file << std::endl;
+    file << "    std::FILE *input = std::fopen(argv[1], \"rb\");" << std::endl;
+    file << "    std::FILE *output = std::fopen(argv[2], \"wb\");" << std::endl;
+    file << "    if (input == nullptr || output == nullptr) {" << std::endl;
+    file << "        std::fprintf(stderr, \"Open the files: failed\\n\");" << std::endl;
+    file << "        return 1;" << std::endl;
+    file << "    }" << std::endl;
+    file << std::endl;
+    file << "    std::vector<std::int64_t> block(BlockSize);" << std::endl;
+    for (std::size_t s = 0; s < filters.size(); ++s) {
+        file << "    std::vector<std::int64_t> buffer" << s << "(Delay" << s << " + BlockSize, 0);" << std::endl;
+    }
+    file << "    std::array<std::uint64_t, NbStage> overflows = {};" << std::endl;
+    file << "    std::uint64_t nbSample = 0;" << std::endl;
+    file << "    std::size_t size = 0;" << std::endl;
+    file << "    while ((size = std::fread(block.data(), sizeof(std::int64_t), BlockSize, input)) > 0) {" << std::endl;
+    for (std::size_t s = 0; s < filters.size(); ++s) {
+        const std::int64_t piOut = filters[s].piOut;
+        file << "        std::memcpy(buffer" << s << ".data() + Delay" << s << ", block.data(), size * sizeof(std::int64_t));" << std::endl;
+        file << "        stage" << s << "(buffer" << s << ".data(), block.data(), size);" << std::endl;
+        file << "        std::memmove(buffer" << s << ".data(), buffer" << s << ".data() + size, Delay" << s << " * sizeof(std::int64_t));" << std::endl;
+        if (piOut < 64) {
+            const std::int64_t maxOut = (std::int64_t(1) << (piOut - 1)) - 1;
+            file << "        for (std::size_t n = 0; n < size; ++n) {" << std::endl;
+            file << "            overflows[" << s << "] += (block[n] < " << -maxOut << " - 1 || block[n] > " << maxOut << ");" << std::endl;
+            file << "        }" << std::endl;
+        }
+    }
+    file << "        std::fwrite(block.data(), sizeof(std::int64_t), size, output);" << std::endl;
+    file << "        nbSample += size;" << std::endl;
+    file << "    }" << std::endl;
+    file << std::endl;
+    file << "    std::printf(\"Simulated samples: %llu\\n\", static_cast<unsigned long long>(nbSample));" << std::endl;
+    file << "    for (std::size_t s = 0; s < NbStage; ++s) {" << std::endl;
+    file << "        if (overflows[s] > 0) {" << std::endl;
+    file << "            std::printf(\"Stage #%zu: %llu samples exceed the output size\\n\", s, static_cast<unsigned long long>(overflows[s]));" << std::endl;
+    file << "        }" << std::endl;
+    file << "    }" << std::endl;
+    file << std::endl;
+    file << "    std::fclose(input);" << std::endl;
+    file << "    return (std::fclose(output) == 0) ? 0 : 1;" << std::endl;
+    file << "}" << std::endl;
+
+    // Projet CMake du simulateur
+    std::string cmakeFilename = experimentName + "/simulator/CMakeLists.txt";
+    std::ofstream cmake(cmakeFilename);
+    if (!cmake.good()) {
+        std::cerr << "ScriptGenerator::generateSimulatorSource: Open " << cmakeFilename << " file: failed" << std::endl;
+        std::exit(1);
+    }
+
+    cmake << "cmake_minimum_required(VERSION 3.0)" << std::endl;
+    cmake << std::endl;
+    cmake << "project(\"Simulator of " << experimentName << "\" LANGUAGES CXX)" << std::endl;
+    cmake << std::endl;
+    cmake << "option(SIMULATOR_NATIVE \"Optimize for the instruction set of the build machine\" ON)" << std::endl;
+    cmake << std::endl;
+    cmake << "if(NOT DEFINED CMAKE_BUILD_TYPE OR CMAKE_BUILD_TYPE STREQUAL \"\")" << std::endl;
+    cmake << "  set(CMAKE_BUILD_TYPE \"Release\")" << std::endl;
+    cmake << "endif()" << std::endl;
+    cmake << std::endl;
+    cmake << "set(CMAKE_CXX_STANDARD 17)" << std::endl;
+    cmake << "set(CMAKE_CXX_STANDARD_REQUIRED ON)" << std::endl;
+    cmake << "set(CMAKE_CXX_FLAGS_RELEASE \"-O3 -DNDEBUG\")" << std::endl;
+    cmake << std::endl;
+    cmake << "if (SIMULATOR_NATIVE)" << std::endl;
+    cmake << "  set(CMAKE_CXX_FLAGS \"${CMAKE_CXX_FLAGS} -march=native\")" << std::endl;
+    cmake << "endif()" << std::endl;
+    cmake << std::endl;
+    cmake << "add_executable(simulator simulator.cc)" << std::endl;
+
+    return true;
+}
+
 std::ofstream ScriptGenerator::createShellFile(const std::string &scriptFilename) {
     std::ofstream file(scriptFilename);
 
@@ -21,7 +21,7 @@
 
 #include <iostream>
 
-class QuadraticProgram;
+class CascadeSolver;
 
 /**
  * @brief Utility class to generate scripts
@@ -31,19 +31,33 @@ public:
     /**
      * @brief Generate the shell script to deploy the design on FPGA board
      *
-     * @param milp The quadratic program
+     * @param milp The solved cascade
      * @param experimentName The name of experimentation
      * @param dtboType The name of dtbo
      */
-    static void generateDeployScript(const QuadraticProgram &milp, const std::string &experimentName, const std::string dtboType);
+    static void generateDeployScript(const CascadeSolver &milp, const std::string &experimentName, const std::string dtboType);
 
     /**
      * @brief Generate the octave simulation script
      *
-     * @param milp The quadratic program
+     * @param milp The solved cascade
      * @param experimentName The name of experimentation
      */
-    static void generateSimulationScript(const QuadraticProgram &milp, const std::string &experimentName);
+    static void generateSimulationScript(const CascadeSolver &milp, const std::string &experimentName);
+
+    /**
+     * @brief Generate a C++ simulator specialized for the solved cascade and its CMakeLists.txt
+     * The files are written in the simulator/ directory of the experiment,
+     * which must exist. The coefficients are constexpr arrays and the products of each stage
+     * are unrolled, so the compiler knows all the taps and shifts. The
+     * coefficients are read from the filter bank of the library, or from the
+     * coefficient files of the current directory.
+     *
+     * @param milp The solved cascade
+     * @param experimentName The name of experimentation
+     * @return false if the coefficients of a filter are missing
+     */
+    static bool generateSimulatorSource(const CascadeSolver &milp, const std::string &experimentName);
 
 private:
     static std::ofstream createShellFile(const std::string &scriptFilename);
@@ -0,0 +1,154 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "SpectrumAnalyzer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+SpectrumAnalyzer::SpectrumAnalyzer(std::size_t frameSize)
+: m_fft(frameSize)
+, m_window(frameSize)
+, m_frame(frameSize)
+, m_filled(0)
+, m_sumInput(frameSize / 2, 0.0)
+, m_sumOutput(frameSize / 2, 0.0)
+, m_nbFrame(0) {
+    // Fenêtre de Hann symétrique, comme hanning(N) d'Octave
+    for (std::size_t k = 0; k < frameSize; ++k) {
+        m_window[k] = 0.5 - 0.5 * std::cos(2.0 * M_PI * (k + 1) / (frameSize + 1));
+    }
+}
+
+void SpectrumAnalyzer::reset() {
+    m_filled = 0;
+    std::fill(m_sumInput.begin(), m_sumInput.end(), 0.0);
+    std::fill(m_sumOutput.begin(), m_sumOutput.end(), 0.0);
+    m_nbFrame = 0;
+}
+
+void SpectrumAnalyzer::add(const std::int64_t *input, const std::int64_t *output, std::size_t size) {
+    const std::size_t frameSize = m_frame.size();
+    for (std::size_t n = 0; n < size; ++n) {
+        // L'entrée est la partie réelle, la sortie la partie imaginaire
+        m_frame[m_filled] = std::complex<double>(input[n] * m_window[m_filled], output[n] * m_window[m_filled]);
+        if (++m_filled == frameSize) {
+            addFrame();
+            m_filled = 0;
+        }
+    }
+}
+
+void SpectrumAnalyzer::merge(const SpectrumAnalyzer &other) {
+    if (other.m_frame.size() != m_frame.size()) {
+        std::cerr << "SpectrumAnalyzer::merge: The frame sizes are different" << std::endl;
+        std::exit(-1);
+    }
+
+    for (std::size_t k = 0; k < m_sumInput.size(); ++k) {
+        m_sumInput[k] += other.m_sumInput[k];
+        m_sumOutput[k] += other.m_sumOutput[k];
+    }
+    m_nbFrame += other.m_nbFrame;
+}
+
+std::uint64_t SpectrumAnalyzer::getNbFrame() const {
+    return m_nbFrame;
+}
+
+const std::vector<double> &SpectrumAnalyzer::getInputMagnitude() const {
+    return m_sumInput;
+}
+
+const std::vector<double> &SpectrumAnalyzer::getOutputMagnitude() const {
+    return m_sumOutput;
+}
+
+std::vector<double> SpectrumAnalyzer::getResponse() const {
+    std::vector<double> response(m_sumInput.size(), 0.0);
+    for (std::size_t k = 0; k < response.size(); ++k) {
+        if (m_sumInput[k] > 0.0) {
+            response[k] = m_sumOutput[k] / m_sumInput[k];
+        }
+    }
+    return response;
+}
+
+SpectrumMeasurement SpectrumAnalyzer::measure(double fc) const {
+    return measure(getResponse(), fc, m_nbFrame);
+}
+
+SpectrumMeasurement SpectrumAnalyzer::measure(const std::vector<double> &response, double fc, std::uint64_t nbFrame) {
+    const std::int64_t points = response.size();
+
+    // Index de la fin de la bande passante et du début de la bande coupée
+    const std::int64_t indexBand = std::llround((fc - 0.1) * points);
+    const std::int64_t indexTail = std::llround((fc + 0.1) * points);
+
+    double reference = 0.0;
+    std::int64_t nbReference = 0;
+    for (std::int64_t m = 0; m < std::min(indexBand, points); ++m) {
+        if (response[m] > 0.0) {
+            reference += response[m];
+            ++nbReference;
+        }
+    }
+    reference = (nbReference > 0) ? reference / nbReference : 1.0;
+
+    double bandMax = -std::numeric_limits<double>::infinity();
+    double bandMin = std::numeric_limits<double>::infinity();
+    double tailMax = -std::numeric_limits<double>::infinity();
+    for (std::int64_t m = 0; m < points; ++m) {
+        if (response[m] <= 0.0) {
+            continue;
+        }
+        const double level = 20.0 * std::log10(response[m] / reference);
+        if (m < indexBand) {
+            bandMax = std::max(bandMax, level);
+            bandMin = std::min(bandMin, level);
+        }
+        if (m >= indexTail) {
+            tailMax = std::max(tailMax, level);
+        }
+    }
+
+    SpectrumMeasurement measurement;
+    measurement.ripple = bandMax - bandMin;
+    measurement.stopband = tailMax;
+    measurement.rejection = -measurement.ripple - measurement.stopband;
+    measurement.nbFrame = nbFrame;
+    return measurement;
+}
+
+void SpectrumAnalyzer::addFrame() {
+    m_fft.transform(m_frame);
+
+    // Séparation des spectres des deux signaux réels : X[k] = (Z[k] + Z*[N-k]) / 2, Y[k] = (Z[k] - Z*[N-k]) / 2j
+    const std::size_t frameSize = m_frame.size();
+    for (std::size_t k = 0; k < m_sumInput.size(); ++k) {
+        const std::complex<double> z = m_frame[k];
+        const std::complex<double> mirror = std::conj(m_frame[(frameSize - k) % frameSize]);
+        // sqrt(norm) plutôt que abs (hypot), les niveaux ne peuvent pas déborder
+        m_sumInput[k] += 0.5 * std::sqrt(std::norm(z + mirror));
+        m_sumOutput[k] += 0.5 * std::sqrt(std::norm(z - mirror));
+    }
+    ++m_nbFrame;
+}
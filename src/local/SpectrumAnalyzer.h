@@ -0,0 +1,133 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef SPECTRUM_ANALYZER_H
+#define SPECTRUM_ANALYZER_H
+
+#include <cinttypes>
+#include <complex>
+#include <vector>
+
+#include "Fft.h"
+
+/**
+ * @brief Rejection measured on the spectrum of a simulation
+ */
+struct SpectrumMeasurement {
+    double rejection;       /*!< Stopband attenuation minus passband ripple, as rejection_criterion() (dB) */
+    double stopband;        /*!< Highest level of the stopband (dB) */
+    double ripple;          /*!< Difference between the highest and the lowest levels of the passband (dB) */
+    std::uint64_t nbFrame;  /*!< Number of averaged frames */
+};
+
+/**
+ * @brief Online Welch estimation of the response of a cascade
+ * The input and the output samples are cut in frames without overlap,
+ * windowed by a Hann window and transformed, as plot_data.m does. The
+ * magnitudes of the frames are averaged, and the response is the ratio of
+ * the output spectrum to the input spectrum. The input and the output frames
+ * share one complex FFT.
+ */
+class SpectrumAnalyzer {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param frameSize Number of samples of a frame (power of two)
+     */
+    SpectrumAnalyzer(std::size_t frameSize = 2048);
+
+    /**
+     * @brief Forget the previous frames
+     */
+    void reset();
+
+    /**
+     * @brief Add the next samples of the input and of the output
+     * The last incomplete frame is ignored.
+     *
+     * @param input Input samples of the cascade
+     * @param output Output samples of the cascade
+     * @param size Number of samples
+     */
+    void add(const std::int64_t *input, const std::int64_t *output, std::size_t size);
+
+    /**
+     * @brief Add the frames averaged by another analyzer of the same frame size
+     *
+     * @param other Analyzer of another part of the signal
+     */
+    void merge(const SpectrumAnalyzer &other);
+
+    /**
+     * @brief Get the number of averaged frames
+     */
+    std::uint64_t getNbFrame() const;
+
+    /**
+     * @brief Get the sum of the input magnitudes of the frames on frameSize / 2 points
+     */
+    const std::vector<double> &getInputMagnitude() const;
+
+    /**
+     * @brief Get the sum of the output magnitudes of the frames on frameSize / 2 points
+     */
+    const std::vector<double> &getOutputMagnitude() const;
+
+    /**
+     * @brief Get the magnitude of the response on frameSize / 2 points
+     * The points without input energy are zero.
+     */
+    std::vector<double> getResponse() const;
+
+    /**
+     * @brief Measure the rejection with the criterion of the filter library
+     * The response is normalized by its mean in the passband. As
+     * rejection_criterion(), the passband ends at fc - 0.1 and the stopband
+     * starts at fc + 0.1 (1 is the Nyquist frequency).
+     *
+     * @param fc Cutoff frequency
+     */
+    SpectrumMeasurement measure(double fc) const;
+
+    /**
+     * @brief Measure the rejection of a response with the criterion of the filter library
+     *
+     * @param response Magnitude of the response (zero on the points to ignore)
+     * @param fc Cutoff frequency
+     * @param nbFrame Number of frames averaged in the response
+     */
+    static SpectrumMeasurement measure(const std::vector<double> &response, double fc, std::uint64_t nbFrame);
+
+private:
+    /**
+     * @brief Transform the current frames and add their magnitudes
+     */
+    void addFrame();
+
+private:
+    Fft m_fft;
+    std::vector<double> m_window;
+    std::vector< std::complex<double> > m_frame;
+    std::size_t m_filled;
+    std::vector<double> m_sumInput;
+    std::vector<double> m_sumOutput;
+    std::uint64_t m_nbFrame;
+};
+
+#endif // SPECTRUM_ANALYZER_H
@@ -0,0 +1,122 @@
+/* Cascade filters solver - Solver to choose the best configuration to design a
+ * cascade of filters
+ * Copyright (C) 2019  Arthur HUGEAT
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Bounded lock-free queue between one producer and one consumer thread
+ * The producer waits while the queue is full (back-pressure) and the
+ * consumer waits while it is empty. A waiting thread spins a little, then
+ * sleeps until the other thread pushes or pops an element, so an idle side
+ * does not burn a core. The mutex is only taken when a thread sleeps.
+ */
+template <typename T>
+class SpscQueue {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param capacity Max number of elements in the queue
+     */
+    SpscQueue(std::size_t capacity)
+    : m_slots(capacity + 1)
+    , m_head(0)
+    , m_tail(0)
+    , m_nbWaiting(0) {
+    }
+
+    /**
+     * @brief Add an element, wait if the queue is full (producer thread only)
+     *
+     * @param value Element to add
+     */
+    void push(const T &value) {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        const std::size_t next = (tail + 1) % m_slots.size();
+        wait([&]() { return next != m_head.load(std::memory_order_acquire); });
+
+        m_slots[tail] = value;
+        m_tail.store(next, std::memory_order_release);
+        wake();
+    }
+
+    /**
+     * @brief Remove the oldest element, wait if the queue is empty (consumer thread only)
+     */
+    T pop() {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        wait([&]() { return head != m_tail.load(std::memory_order_acquire); });
+
+        T value = m_slots[head];
+        m_head.store((head + 1) % m_slots.size(), std::memory_order_release);
+        wake();
+        return value;
+    }
+
+private:
+    // Nombre de tests avant de s'endormir
+    static constexpr int SpinCount = 256;
+
+    /**
+     * @brief Wait until the condition is true, spinning then sleeping
+     *
+     * @param ready Condition read from the index of the other thread
+     */
+    template <typename Condition>
+    void wait(Condition ready) {
+        for (int spin = 0; spin < SpinCount; ++spin) {
+            if (ready()) {
+                return;
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_nbWaiting.fetch_add(1, std::memory_order_relaxed);
+        // L'annonce de l'attente est vue par wake(), ou la condition voit le nouvel index
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        m_condition.wait(lock, ready);
+        m_nbWaiting.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Wake the other thread up if it sleeps in wait()
+     */
+    void wake() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_nbWaiting.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_condition.notify_all();
+        }
+    }
+
+    std::vector<T> m_slots;
+    alignas(64) std::atomic<std::size_t> m_head;    /*!< Next element to pop, written by the consumer */
+    alignas(64) std::atomic<std::size_t> m_tail;    /*!< Next free slot, written by the producer */
+    alignas(64) std::atomic<int> m_nbWaiting;       /*!< Number of threads sleeping in wait() */
+    std::mutex m_mutex;                             /*!< Protects the sleep of a waiting thread */
+    std::condition_variable m_condition;            /*!< Wakes a waiting thread up */
+};
+
+#endif // SPSC_QUEUE_H
@@ -20,7 +20,7 @@
 
 #include <thread>
 
-#include "QuadraticProgram.h"
+#include "CascadeSolver.h"
 
 void TclADC::writeTclHeader(std::ofstream &file, const std::string &experimentName) {
     file << "variable fpga_ip    $::env(OSC_IMP_IP)" << std::endl;
@@ -22,7 +22,7 @@
 #include <iostream>
 #include <string>
 
-#include "QuadraticProgram.h"
+#include "CascadeSolver.h"
 
 void TclProject::writeMakefile(std::ofstream &file, const std::string &experimentName)
 {   file << "NAME=" << experimentName << std::endl;
@@ -30,12 +30,12 @@ void TclProject::writeMakefile(std::ofstream &file, const std::string &experimen
     file << "include ${OSCIMP_DIGITAL_IP}/xilinx.mk" << std::endl;
 }
 
-void TclProject::generate(const QuadraticProgram &milp, const std::string &experimentName) {
+void TclProject::generate(const CascadeSolver &milp, const std::string &experimentName) {
     // We generate the tcl file
     generateProjectFile(milp, experimentName);
 }
 
-void TclProject::generateProjectFile(const QuadraticProgram &milp, const std::string &experimentName) {
+void TclProject::generateProjectFile(const CascadeSolver &milp, const std::string &experimentName) {
     // Create the Makefile
     std::string makeFilename = experimentName + "/Makefile";
     std::ofstream filem(makeFilename);
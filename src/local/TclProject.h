@@ -22,7 +22,7 @@
 #include <fstream>
 
 class Fir;
-class QuadraticProgram;
+class CascadeSolver;
 class SelectedFilter;
 
 /**
@@ -33,10 +33,10 @@ public:
     /**
      * @brief Generate the TCL script
      *
-     * @param milp The quadratic program
+     * @param milp The solved cascade
      * @param experimentName The name of experimentation
      */
-    void generate(const QuadraticProgram &milp, const std::string &experimentName);
+    void generate(const CascadeSolver &milp, const std::string &experimentName);
 
 protected:
     void writeMakefile(std::ofstream &file, const std::string &experimentName);
@@ -44,10 +44,10 @@ protected:
     /**
      * @brief Create the TCL file
      *
-     * @param milp The quadratic program
+     * @param milp The solved cascade
      * @param experimentName The experiment name
      */
-    void generateProjectFile(const QuadraticProgram &milp, const std::string &experimentName);
+    void generateProjectFile(const CascadeSolver &milp, const std::string &experimentName);
 
     /**
      * @brief Create the header of TCL script (PS7, ADC source...)
@@ -16,74 +16,316 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>
  */
 
-#include <sys/stat.h>
-
+#include <exception>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <thread>
 
-#include "local/MaximizeRejection.h"
-#include "local/MinimizeArea.h"
-#include "local/ScriptGenerator.h"
-#include "local/TclPRN.h"
-
-static bool createDirectory(const std::string &path) {
-    const int dir_err = ::mkdir(path.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
-    if (-1 == dir_err && errno != EEXIST) {
-        return false;
-    }
+#include "local/BatchRunner.h"
+#include "local/CascadeSimulator.h"
+#include "local/CascadeVerifier.h"
+#include "local/DynamicProgram.h"
+#include "local/FilterBank.h"
+#include "local/ResponseCache.h"
 
-    return true;
+static void printUsage(const char *program) {
+    std::cerr << "Usage:" << std::endl;
+    std::cerr << "\t" << program << " [--engine gurobi|dp] [--formulation quadratic|compact|flow] [--verify RESPONSE_CACHE] [--debug-lp] [--cache DIRECTORY] [--simulate RAW_DATA_FILE] [--responses RESPONSE_CACHE] --max_rej|--min_area NUMBER_STAGE CONSTRAINT_LIMIT JSON_FILTERS_FILE EXPERIMENT_NAME" << std::endl;
+    std::cerr << "\t" << program << " [--engine gurobi|dp] [--formulation quadratic|compact|flow] [--verify RESPONSE_CACHE] [--debug-lp] [--cache DIRECTORY] [--simulate RAW_DATA_FILE] [--responses RESPONSE_CACHE] --stages FIRST..LAST --max_rej|--min_area CONSTRAINT_LIMIT JSON_FILTERS_FILE EXPERIMENT_NAME" << std::endl;
+    std::cerr << "\t" << program << " [--engine gurobi|dp] [--formulation quadratic|compact|flow] [--verify RESPONSE_CACHE] [--debug-lp] --limits LIMIT,LIMIT,... --max_rej|--min_area NUMBER_STAGE JSON_FILTERS_FILE" << std::endl;
+    std::cerr << "\t" << program << " --pareto NUMBER_STAGE JSON_FILTERS_FILE" << std::endl;
+    std::cerr << "\t" << program << " [--threads NUMBER_THREAD] [--cache DIRECTORY] --batch JSON_JOBS_FILE" << std::endl;
 }
 
 int main(int argc, char *argv[]) {
+    // Lecture des options
+#ifdef WITH_GUROBI
+    std::string engine = "gurobi";
+#else
+    std::string engine = "dp";
+#endif
+    std::string formulation = "quadratic";
+    std::string stages;
+    std::string limits;
+    std::string cacheDirectory;
+    std::string rawDataFile;
+    std::string responseCacheFile;
+    std::string verifyCache;
+    bool debugLp = false;
+    std::size_t nbThreads = std::thread::hardware_concurrency();
+    int firstParameter = 1;
+    while (firstParameter + 1 < argc) {
+        const std::string option = argv[firstParameter];
+        if (option == "--debug-lp") {
+            // Option sans valeur
+            debugLp = true;
+            firstParameter += 1;
+            continue;
+        }
+        else if (option == "--engine") {
+            engine = argv[firstParameter + 1];
+        }
+        else if (option == "--formulation") {
+            formulation = argv[firstParameter + 1];
+        }
+        else if (option == "--stages") {
+            stages = argv[firstParameter + 1];
+        }
+        else if (option == "--limits") {
+            limits = argv[firstParameter + 1];
+        }
+        else if (option == "--cache") {
+            cacheDirectory = argv[firstParameter + 1];
+        }
+        else if (option == "--simulate") {
+            rawDataFile = argv[firstParameter + 1];
+        }
+        else if (option == "--responses") {
+            responseCacheFile = argv[firstParameter + 1];
+        }
+        else if (option == "--verify") {
+            verifyCache = argv[firstParameter + 1];
+        }
+        else if (option == "--threads") {
+            nbThreads = std::stoul(argv[firstParameter + 1]);
+        }
+        else {
+            break;
+        }
+        firstParameter += 2;
+    }
+
+    // Front de Pareto aire/réjection, toujours calculé par programmation dynamique
+    if (firstParameter < argc && std::string(argv[firstParameter]) == "--pareto") {
+        if (argc - firstParameter != 3) {
+            std::cerr << "Missing parameter" << std::endl;
+            printUsage(argv[0]);
+            std::exit(1);
+        }
+
+        const std::int64_t nbStage = std::stoul(argv[firstParameter + 1]);
+        const std::string jsonPath = argv[firstParameter + 2];
+
+        try {
+            DynamicProgram pareto(DynamicProgram::Mode::ParetoFront, nbStage, 0.0, jsonPath, "");
+            if (!pareto.solve()) {
+                std::cerr << "No feasible cascade" << std::endl;
+                std::exit(1);
+            }
+            pareto.printResults();
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            std::exit(1);
+        }
+
+        return 0;
+    }
+
+    // Liste de jobs résolus en parallèle
+    if (firstParameter < argc && std::string(argv[firstParameter]) == "--batch") {
+        if (argc - firstParameter != 2) {
+            std::cerr << "Missing parameter" << std::endl;
+            printUsage(argv[0]);
+            std::exit(1);
+        }
+
+        BatchRunner batch(argv[firstParameter + 1], cacheDirectory);
+        return batch.run(nbThreads) ? 0 : 1;
+    }
+
+    // Balayage des limites sur un seul modèle
+    if (!limits.empty()) {
+        if (argc - firstParameter != 3 || !stages.empty()) {
+            std::cerr << "Missing parameter" << std::endl;
+            printUsage(argv[0]);
+            std::exit(1);
+        }
+
+        const std::string milpOption = argv[firstParameter];
+        const std::int64_t nbStage = std::stoul(argv[firstParameter + 1]);
+        const std::string jsonPath = argv[firstParameter + 2];
+        if (milpOption != "--max_rej" && milpOption != "--min_area") {
+            std::cerr << "'" << milpOption << "' is not a valid option" << std::endl;
+            printUsage(argv[0]);
+            std::exit(1);
+        }
+
+        // Liste LIMIT,LIMIT,...
+        std::vector<double> values;
+        std::size_t begin = 0;
+        while (begin <= limits.size()) {
+            std::size_t end = limits.find(',', begin);
+            if (end == std::string::npos) {
+                end = limits.size();
+            }
+            values.push_back(std::strtod(limits.substr(begin, end - begin).c_str(), nullptr));
+            begin = end + 1;
+        }
+
+        SolverJob job = { engine, formulation, milpOption, nbStage, nbStage, 0.0, jsonPath, "", "", verifyCache, debugLp };
+        bool found = false;
+        try {
+            found = BatchRunner::sweepLimits(job, values, nullptr);
+#ifdef WITH_GUROBI
+        } catch (GRBException e) {
+            std::cerr << e.getMessage() << std::endl;
+#endif
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+        }
+
+        return found ? 0 : 1;
+    }
+
     // Vérification des paramètres
-    if (argc != 6) {
+    const int nbParameter = (stages.empty()) ? 5 : 4;
+    if (argc - firstParameter != nbParameter) {
         std::cerr << "Missing parameter" << std::endl;
-        std::cerr << "Usage:" << std::endl;
-        std::cerr << "\t" << argv[0] << " --max_rej|--min_area NUMBER_STAGE CONSTRAINT_LIMIT JSON_FILTERS_FILE EXPERIMENT_NAME" << std::endl;
+        printUsage(argv[0]);
         std::exit(1);
     }
 
     // Définition des paramètres
-    std::string milpOption = std::string(argv[1]);
-    const std::int64_t nbStage = std::stoul(argv[2]);
-    const double constraintLimit = std::strtod(argv[3], nullptr);
-    const std::string jsonPath = argv[4];
-    const std::string experimentName = argv[5];
-
-    // Select the right problem
-    QuadraticProgram *milp = nullptr;
-    if (milpOption == "--max_rej") {
-        milp = new MaximizeRejection(nbStage, constraintLimit, jsonPath, experimentName);
-    }
-    else if (milpOption == "--min_area") {
-        milp = new MinimizeArea(nbStage, constraintLimit, jsonPath, experimentName);
+    std::string milpOption = std::string(argv[firstParameter]);
+    std::int64_t firstStage = 0;
+    std::int64_t lastStage = 0;
+    if (stages.empty()) {
+        firstStage = std::stoul(argv[firstParameter + 1]);
+        lastStage = firstStage;
+        ++firstParameter;
     }
     else {
+        // Intervalle FIRST..LAST
+        std::size_t separator = stages.find("..");
+        if (separator == std::string::npos) {
+            std::cerr << "'" << stages << "' is not a valid stage range" << std::endl;
+            printUsage(argv[0]);
+            std::exit(1);
+        }
+        firstStage = std::stoul(stages.substr(0, separator));
+        lastStage = std::stoul(stages.substr(separator + 2));
+    }
+    const double constraintLimit = std::strtod(argv[firstParameter + 1], nullptr);
+    const std::string jsonPath = argv[firstParameter + 2];
+    const std::string experimentName = argv[firstParameter + 3];
+
+    if (milpOption != "--max_rej" && milpOption != "--min_area") {
         std::cerr << "'" << milpOption << "' is not a valid option" << std::endl;
-        std::cerr << "Usage:" << std::endl;
-        std::cerr << "\t" << argv[0] << " --max_rej|--min_area NUMBER_STAGE AREA_MAX FIRLS_DATA FIR1_DATA EXPERIMENT_NAME" << std::endl;
+        printUsage(argv[0]);
         std::exit(1);
     }
 
-    // Création du répertoire de destination
-    if (!createDirectory(experimentName)) {
-        std::cerr << "createDirectory(): create '" << experimentName << "' directory: failed" << std::endl;
+    if (firstStage < 1 || lastStage < firstStage) {
+        std::cerr << "The number of stages must be at least 1" << std::endl;
+        printUsage(argv[0]);
         std::exit(1);
     }
 
-    std::cout << "### Start LP solver... ###" << std::endl;
+    SolverJob job = { engine, formulation, milpOption, firstStage, lastStage, constraintLimit, jsonPath, experimentName, cacheDirectory, verifyCache, debugLp };
+
+    CascadeSolver *milp = nullptr;
     try {
+      // Select the right problem and solve it for each number of stages
+      milp = BatchRunner::solveJob(job, nullptr);
+      if (milp == nullptr) {
+          std::cerr << "No feasible cascade" << std::endl;
+          std::exit(1);
+      }
+
+      std::cout << "### Start LP solver... ###" << std::endl;
+      if (!BatchRunner::writeResults(*milp, experimentName)) {
+          std::exit(1);
+      }
       milp->printDebugFiles();
       milp->printResults();
-      milp->printResults("sol.txt");
 
-      TclPRN tcl;
-      tcl.generate(*milp, experimentName);
+      // Réjection de la réponse de la cascade retenue
+      if (!verifyCache.empty()) {
+          CascadeVerifier verifier(jsonPath, verifyCache);
+          std::vector<Fir> cascade;
+          for (const SelectedFilter &filter: milp->getSelectedFilters()) {
+              cascade.push_back(filter.filter);
+          }
+          double rejection = 0.0;
+          if (verifier.measure(cascade, rejection)) {
+              std::cout << "Verified rejection: " << rejection << " dB" << std::endl;
+          }
+      }
+
+      // Simulation de la cascade avec les coefficients de l'archive ou les fichiers du répertoire courant
+      if (!rawDataFile.empty()) {
+          std::cout << std::endl;
+          std::cout << "### Simulation ###" << std::endl;
+          std::unique_ptr<CascadeSimulator> simulator;
+          if (FilterBank::isFilterBank(jsonPath)) {
+              FilterBank bank(jsonPath);
+              if (!bank.isOpen()) {
+                  std::cerr << "The filter bank '" << jsonPath << "' is not valid" << std::endl;
+                  std::exit(1);
+              }
+              simulator.reset(new CascadeSimulator(milp->getSelectedFilters(), bank));
+          }
+          else {
+              simulator.reset(new CascadeSimulator(milp->getSelectedFilters(), "."));
+          }
+          simulator->setSpectrum(2048, 0.5);
+          if (!simulator->simulate(rawDataFile, experimentName + "/simu_stage.bin")) {
+              std::exit(1);
+          }
+      }
+
+      // Réponse des coefficients quantifiés, sans FFT ni Octave
+      if (!responseCacheFile.empty()) {
+          std::cout << std::endl;
+          std::cout << "### Response cache ###" << std::endl;
+          ResponseCache cache(responseCacheFile);
+          if (!cache.isOpen()) {
+              std::cerr << "The response cache '" << responseCacheFile << "' is missing or not valid" << std::endl;
+              std::exit(1);
+          }
+          if (!FilterBank::isFilterBank(jsonPath)) {
+              std::cerr << "The response cache needs a filter bank as filter library" << std::endl;
+              std::exit(1);
+          }
+          FilterBank bank(jsonPath);
+
+          std::vector< std::vector<std::int64_t> > stages;
+          for (const SelectedFilter &filter: milp->getSelectedFilters()) {
+              const std::int64_t index = bank.isOpen() ? bank.find(filter.filter.getFilterName()) : -1;
+              if (index < 0) {
+                  std::cerr << "The filter '" << filter.filter.getFilterName() << "' is not in the filter bank" << std::endl;
+                  std::exit(1);
+              }
+              const std::int32_t *taps = bank.getTaps(index);
+              stages.emplace_back(taps, taps + bank.getEntry(index).cardC);
+          }
+
+          std::vector<float> response;
+          if (!cache.getCascadeResponse(stages, response)) {
+              std::cerr << "A filter of the cascade is not in the response cache" << std::endl;
+              std::exit(1);
+          }
+          std::cout << "Response rejection: " << ResponseCache::measureRejection(response, 0.5) << " dB (" << response.size() << " points)" << std::endl;
 
-      ScriptGenerator::generateDeployScript(*milp, experimentName, "prn");
-      ScriptGenerator::generateSimulationScript(*milp, experimentName);
+          // Même contenu que log_freqz du script Octave
+          const std::string responseFile = experimentName + "/freqz_" + std::to_string(stages.size()) + "_stage.bin";
+          const std::vector<double> levels(response.begin(), response.end());
+          std::ofstream file(responseFile, std::ios::binary);
+          file.write(reinterpret_cast<const char *>(levels.data()), levels.size() * sizeof(double));
+          if (!file.good()) {
+              std::cerr << "Write '" << responseFile << "': failed" << std::endl;
+              std::exit(1);
+          }
+      }
+#ifdef WITH_GUROBI
     } catch (GRBException e) {
       std::cerr << e.getMessage() << std::endl;
+#endif
+    } catch (const std::exception &e) {
+      std::cerr << e.what() << std::endl;
+      delete milp;
+      return 1;
     }
 
     delete milp;
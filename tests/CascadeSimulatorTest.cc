@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <cinttypes>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CascadeSimulator.h"
+
+namespace {
+    // Taille des blocs de cascaded-filters
+    constexpr std::size_t BlockSize = 1 << 16;
+
+    // Accumulateur du noyau attendu
+    enum Kernel { Int16 = 0, Int32 = 1, Int64 = 2 };
+
+    struct TestStage {
+        std::vector<std::int64_t> coeffs;
+        std::int64_t shift;
+    };
+
+    int nbFailure = 0;
+
+    void check(bool condition, const std::string &message) {
+        if (!condition) {
+            std::cerr << "FAILED: " << message << std::endl;
+            ++nbFailure;
+        }
+    }
+
+    std::int64_t sumAbs(const std::vector<std::int64_t> &coeffs) {
+        std::int64_t sum = 0;
+        for (std::int64_t coeff: coeffs) {
+            sum += std::abs(coeff);
+        }
+        return sum;
+    }
+
+    /**
+     * Convolution directe sur int64, sans blocs ni historique
+     */
+    std::vector<std::int64_t> referenceCascade(const std::vector<TestStage> &stages, std::vector<std::int64_t> samples) {
+        for (const TestStage &stage: stages) {
+            std::vector<std::int64_t> output(samples.size(), 0);
+            for (std::size_t n = 0; n < samples.size(); ++n) {
+                std::int64_t acc = 0;
+                for (std::size_t k = 0; k < stage.coeffs.size() && k <= n; ++k) {
+                    acc += stage.coeffs[k] * samples[n - k];
+                }
+                output[n] = acc >> stage.shift;
+            }
+            samples.swap(output);
+        }
+        return samples;
+    }
+
+    /**
+     * Simule la cascade par blocs de tailles données et la compare à la référence
+     */
+    void runCascade(const std::string &name, const std::vector<TestStage> &stages, const std::vector<std::int64_t> &input, const std::vector<std::size_t> &blockSizes, bool selfCheck, int firstKernel) {
+        std::vector<SimulationStage> descriptions;
+        for (std::size_t s = 0; s < stages.size(); ++s) {
+            const std::string file = "taps_" + std::to_string(s) + ".txt";
+            std::ofstream taps(file);
+            for (std::int64_t coeff: stages[s].coeffs) {
+                taps << coeff << std::endl;
+            }
+            descriptions.push_back({ file, stages[s].shift, 64 });
+        }
+
+        CascadeSimulator simulator(descriptions);
+        simulator.setSelfCheck(selfCheck);
+
+        std::vector<std::int64_t> output(input.size());
+        std::size_t position = 0;
+        for (std::size_t b = 0; position < input.size(); ++b) {
+            const std::size_t size = std::min(blockSizes[b % blockSizes.size()], input.size() - position);
+            simulator.process(input.data() + position, output.data() + position, size);
+            position += size;
+        }
+
+        const std::vector<std::int64_t> expected = referenceCascade(stages, input);
+        std::size_t mismatch = 0;
+        while (mismatch < output.size() && output[mismatch] == expected[mismatch]) {
+            ++mismatch;
+        }
+        check(mismatch == output.size(), name + ": first difference at sample " + std::to_string(mismatch) + (mismatch < output.size() ? " (" + std::to_string(output[mismatch]) + " instead of " + std::to_string(expected[mismatch]) + ")" : ""));
+
+        if (firstKernel >= 0) {
+            const std::vector<std::uint64_t> blocks = simulator.getKernelBlocks(0);
+            check(blocks[firstKernel] > 0, name + ": the expected kernel of the first stage is not used");
+        }
+    }
+
+    std::vector<std::int64_t> randomInput(std::mt19937_64 &generator, std::size_t size, std::int64_t maxAbs) {
+        std::uniform_int_distribution<std::int64_t> distribution(-maxAbs, maxAbs);
+        std::vector<std::int64_t> samples(size);
+        for (std::int64_t &sample: samples) {
+            sample = distribution(generator);
+        }
+        return samples;
+    }
+
+    std::vector<std::int64_t> randomTaps(std::mt19937_64 &generator, std::size_t nbTap, bool symmetric) {
+        std::uniform_int_distribution<std::int64_t> distribution(-60, 60);
+        std::vector<std::int64_t> coeffs(nbTap);
+        for (std::size_t k = 0; k < nbTap; ++k) {
+            coeffs[k] = (symmetric && k >= (nbTap + 1) / 2) ? coeffs[nbTap - 1 - k] : distribution(generator);
+        }
+        return coeffs;
+    }
+
+    /**
+     * Amplitude des entrées choisissant le noyau int16, int32 ou int64
+     */
+    std::int64_t kernelAmplitude(const std::vector<std::int64_t> &coeffs, Kernel kernel) {
+        const std::int64_t sum = sumAbs(coeffs);
+        switch (kernel) {
+        case Int16:
+            return std::numeric_limits<std::int16_t>::max() / sum;
+        case Int32:
+            return std::numeric_limits<std::int32_t>::max() / sum;
+        default:
+            return std::int64_t(1) << 40;
+        }
+    }
+}
+
+int main() {
+    std::mt19937_64 generator(2019);
+
+    // Grand échantillon juste avant la frontière d'un bloc de 64k
+    {
+        std::vector<std::int64_t> input(BlockSize + 1000, 5000);
+        std::fill(input.begin(), input.begin() + BlockSize - 1, 0);
+        input[BlockSize - 1] = 30000;
+        runCascade("boundary int16", { { { 1, 1 }, 0 } }, input, { BlockSize }, false, -1);
+
+        input[BlockSize - 1] = std::int64_t(1) << 33;
+        runCascade("boundary int32", { { { 1, 1 }, 0 } }, input, { BlockSize }, false, -1);
+    }
+
+    // Filtres symétriques de longueur impaire et paire, et un filtre quelconque
+    const std::vector< std::pair<std::string, std::vector<std::int64_t>> > filters = {
+        { "odd symmetric", randomTaps(generator, 7, true) },
+        { "even symmetric", randomTaps(generator, 8, true) },
+        { "long odd symmetric", randomTaps(generator, 61, true) },
+        { "long even symmetric", randomTaps(generator, 60, true) },
+        { "generic", randomTaps(generator, 9, false) },
+    };
+    const std::vector<std::pair<std::string, Kernel>> kernels = { { "int16", Int16 }, { "int32", Int32 }, { "int64", Int64 } };
+    const std::vector<std::size_t> blockSizes = { 1, 4097, BlockSize, 3, 2048, 10000 };
+
+    for (const auto &filter: filters) {
+        for (const auto &kernel: kernels) {
+            const std::int64_t amplitude = kernelAmplitude(filter.second, kernel.second);
+            std::vector<std::int64_t> input = randomInput(generator, 3 * BlockSize, amplitude);
+            for (bool selfCheck: { false, true }) {
+                const std::string name = filter.first + " " + kernel.first + (selfCheck ? " (self check)" : "");
+                runCascade(name, { { filter.second, 3 } }, input, blockSizes, selfCheck, kernel.second);
+            }
+
+            // Un bloc sur deux finit par un grand échantillon : le bloc suivant, petit, le lit dans son historique
+            if (kernel.second != Int64) {
+                std::vector<std::int64_t> spiky = randomInput(generator, 3 * BlockSize, kernelAmplitude(filter.second, Int16));
+                for (std::size_t n = 4096 - 1; n < spiky.size(); n += 2 * 4096) {
+                    spiky[n] = 2 * amplitude * sumAbs(filter.second);
+                }
+                runCascade(filter.first + " " + kernel.first + " spikes", { { filter.second, 0 } }, spiky, { 4096 }, false, -1);
+            }
+        }
+    }
+
+    // Cascade de deux étages avec des shifts
+    {
+        std::vector<std::int64_t> input = randomInput(generator, 2 * BlockSize + 123, 1 << 14);
+        runCascade("cascade", { { filters[0].second, 4 }, { filters[1].second, 2 } }, input, { BlockSize, 777 }, false, -1);
+    }
+
+    if (nbFailure > 0) {
+        std::cerr << nbFailure << " failed checks" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All checks passed" << std::endl;
+    return 0;
+}
@@ -1,104 +1,131 @@
 #include <cstdlib>
 #include <iostream>
-#include <utility>
+#include <memory>
+#include <string>
+#include <vector>
 
-#include <dsps/FileSink.h>
-#include <dsps/FileSource.h>
-#include <dsps/Fir.h>
-#include <dsps/Shifter.h>
-#include <dsps/Utils.h>
-
-struct FilterStage {
-    std::string filterName;
-    std::int64_t shift;
-    std::int64_t maxNobFir;
-};
+#include "BatchSimulator.h"
+#include "CascadeSimulator.h"
+#include "FilterBank.h"
 
 int main(int argc, char *argv[]) {
-    if (argc < 5 || (argc - 3) % 3 != 0) {
+    const std::string program = argv[0];
+
+    // Options before the files
+    bool selfCheck = false;
+    bool pipeline = false;
+    bool pinThreads = false;
+    std::size_t nbThreads = 1;
+    double fc = -1.0;
+    std::string cascadesFile;
+    std::unique_ptr<FilterBank> bank;
+    while (argc > 1 && std::string(argv[1]).compare(0, 2, "--") == 0) {
+        std::string option = argv[1];
+        if (option == "--check") {
+            // Compare the symmetric kernel to the generic one
+            selfCheck = true;
+        }
+        else if (option == "--pipeline") {
+            // One thread by stage
+            pipeline = true;
+        }
+        else if (option == "--pin") {
+            // One core by stage thread
+            pipeline = true;
+            pinThreads = true;
+        }
+        else if (option == "--threads" && argc > 2) {
+            // Chunks of the file simulated in parallel (0 for all the cores)
+            nbThreads = std::atoll(argv[2]);
+            --argc;
+            ++argv;
+        }
+        else if (option == "--batch" && argc > 2) {
+            // Measure all the cascades of a file on one pass of the input
+            cascadesFile = argv[2];
+            --argc;
+            ++argv;
+        }
+        else if (option == "--bank" && argc > 2) {
+            // Read the coefficients of the filter names in a filter bank
+            bank.reset(new FilterBank(argv[2]));
+            if (!bank->isOpen()) {
+                std::cerr << "The filter bank '" << argv[2] << "' is missing or not valid" << std::endl;
+                return 1;
+            }
+            --argc;
+            ++argv;
+        }
+        else if (option == "--spectrum" && argc > 2) {
+            // Measure the rejection around the cutoff frequency
+            fc = std::atof(argv[2]);
+            --argc;
+            ++argv;
+        }
+        else {
+            std::cerr << "Unknown option '" << option << "'" << std::endl;
+            return 1;
+        }
+        --argc;
+        ++argv;
+    }
+
+    if (!cascadesFile.empty() && argc == 2) {
+        BatchSimulator batch(cascadesFile, bank.get());
+        if (!batch.simulate(argv[1], nbThreads, (fc >= 0.0) ? fc : 0.5)) {
+            return 1;
+        }
+        batch.printResults();
+
+        return 0;
+    }
+
+    if (argc < 6 || (argc - 3) % 3 != 0) {
         std::cerr << "Wrong parameters" << std::endl;
         std::cerr << "Usage:" << std::endl;
-        std::cerr << "\t" << argv[0] << " RAW_DATA_FILE OUTPUT_FILE FIR1_FILE SHIFT1_VALUE NOB_MAX_FIR [FIRN_FILE SHIFTN_VALUE NOB_MAX_FIR ...]" << std::endl;
+        std::cerr << "\t" << program << " [--bank ARCHIVE] [--threads N] [--spectrum FC] --batch CASCADES_FILE RAW_DATA_FILE" << std::endl;
+        std::cerr << "\t" << program << " [--bank ARCHIVE] [--check] [--pipeline] [--pin] [--threads N] [--spectrum FC] RAW_DATA_FILE OUTPUT_FILE|- FIR1_FILE SHIFT1_VALUE NOB_MAX_FIR [FIRN_FILE SHIFTN_VALUE NOB_MAX_FIR ...]" << std::endl;
 
         return 1;
     }
 
-    constexpr std::int64_t N = 2048;
-
     // Get the input file
     std::string rawDataFile = argv[1];
     std::string outputFile = argv[2];
+    if (outputFile == "-") {
+        outputFile.clear();
+    }
+    if (pipeline && (fc >= 0.0 || outputFile.empty())) {
+        std::cerr << "The pipeline needs an output file and does not measure the spectrum" << std::endl;
+        return 1;
+    }
 
     // Get the list of filters
-    std::vector<FilterStage> filters;
+    std::vector<SimulationStage> stages;
     for (int i = 0; i < argc - 3; i += 3) {
-        FilterStage stage = {argv[3 + i], std::atoll(argv[4 + i]), std::atoll(argv[5 + i])};
-        filters.push_back(stage);
+        SimulationStage stage = {argv[3 + i], std::atoll(argv[4 + i]), std::atoll(argv[5 + i])};
+        stages.push_back(stage);
     }
 
-    // Create the DSP
-    FileSource source(rawDataFile, FileSource::FileFormat::BinaryInteger);
-
-    // Create filter stages
-    Task *previousSource = &source;
-    std::vector<Task*> garbages;
-    for (std::size_t i = 0; i < filters.size(); ++i) {
-        FilterStage &stage = filters[i];
-        Fir<std::int64_t> *fir = new Fir<std::int64_t>(stage.filterName, 1, stage.maxNobFir);
-        garbages.push_back(fir);
-        Task::connect(*previousSource, *fir);
-
-        if (stage.shift > 0) {
-            Shifter<std::int64_t> *shifter = new Shifter<std::int64_t>(stage.shift);
-            garbages.push_back(shifter);
-            Task::connect(*fir, *shifter);
-
-            previousSource = shifter;
-        }
-        else {
-            previousSource = fir;
-        }
+    // Simulate the cascade on the whole file
+    CascadeSimulator simulator(stages, bank.get());
+    simulator.setSelfCheck(selfCheck);
+    if (fc >= 0.0) {
+        simulator.setSpectrum(2048, fc);
     }
-
-    // Create output
-    FileSink<std::int64_t> sink(outputFile);
-    Task::connect(*previousSource, sink);
-
-    for (std::size_t i = 0; i < 2000; ++i) {
-        DSP::processing({ &source }, { &sink }, N);
+    bool success = false;
+    if (pipeline) {
+        success = simulator.simulatePipelined(rawDataFile, outputFile, pinThreads);
+    }
+    else if (nbThreads != 1) {
+        success = simulator.simulateParallel(rawDataFile, outputFile, nbThreads);
+    }
+    else {
+        success = simulator.simulate(rawDataFile, outputFile);
+    }
+    if (!success) {
+        return 1;
     }
-
-    // std::string inputFile = argv[1];
-    // std::string coeffFile1 = argv[2];
-    // std::string coeffFile2 = argv[3];
-    // constexpr std::int64_t N = 2048;
-    // constexpr std::int64_t n = N * 1000;
-    //
-    // for (int i = 14; i >= 0; --i) {
-    //     FileSource source(inputFile, FileSource::FileFormat::BinaryInteger);
-    //     Fir<std::int64_t> fir1(coeffFile1, 1);
-    //     Task::connect(source, fir1);
-    //
-    //     Splitter<std::int64_t> splitter1(2);
-    //     FileSink<std::int64_t> sink1("simulation_post_fir1_" + std::to_string(i) + ".bin", true);
-    //     Shifter<std::int64_t> shifter(i);
-    //     Task::connect(fir1, splitter1);
-    //     Task::connect(splitter1, shifter);
-    //     Task::connect(splitter1, 1, sink1, 0);
-    //
-    //     Splitter<std::int64_t> splitter2(2);
-    //     FileSink<std::int64_t> sink2("simulation_post_shift" + std::to_string(i) + ".bin", true);
-    //     Fir<std::int64_t> fir2(coeffFile2, 1);
-    //     Task::connect(shifter, splitter2);
-    //     Task::connect(splitter2, fir2);
-    //     Task::connect(splitter2, 1, sink2, 0);
-    //
-    //     FileSink<std::int64_t> sink3("simulation_post_fir2_" + std::to_string(i) + ".bin", true);
-    //
-    //     Task::connect(fir2, sink3);
-    //
-    //     DSP::processing({ &source }, { &sink1, &sink2, &sink3 }, n);
-    // }
 
     return 0;
 }
@@ -0,0 +1,582 @@
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "Fft.h"
+#include "FilterBank.h"
+#include "MappedFile.h"
+#include "ResponseCache.h"
+
+/**
+ * @brief Parameters of the characterization
+ */
+struct Settings {
+    std::string method = "firls";           /*!< Generation method (firls or fir1) */
+    std::vector<std::int64_t> coeffs;       /*!< Numbers of coefficients */
+    std::vector<std::int64_t> bits;         /*!< Numbers of bits of the coefficients */
+    double passEdge = 0.45;                 /*!< End of the passband of firls (normalized frequency) */
+    double stopEdge = 0.55;                 /*!< Start of the stopband of firls (normalized frequency) */
+    double fc = 0.5;                        /*!< Cutoff of fir1 and of the rejection criterion */
+    std::int64_t points = 2048;             /*!< Number of points of the frequency response */
+    std::size_t threads = 0;                /*!< Number of threads (0 for all the cores) */
+    std::string coefficientsDirectory;      /*!< Directory of the coefficient files (empty to skip them) */
+    std::string archiveFile;                /*!< Filter bank with the coefficients (empty to skip it) */
+    std::string responsesBank;              /*!< Filter bank whose responses are cached (empty to characterize) */
+    std::string outputFile;                 /*!< Library file */
+};
+
+/**
+ * @brief Parse an Octave range "FIRST:LAST" or "FIRST:STEP:LAST"
+ */
+static std::vector<std::int64_t> parseRange(const std::string &range) {
+    std::vector<std::int64_t> fields;
+    std::size_t begin = 0;
+    while (begin <= range.size()) {
+        std::size_t end = range.find(':', begin);
+        if (end == std::string::npos) {
+            end = range.size();
+        }
+        fields.push_back(std::atoll(range.substr(begin, end - begin).c_str()));
+        begin = end + 1;
+    }
+
+    std::int64_t first = fields.front();
+    std::int64_t step = (fields.size() == 3) ? fields[1] : 1;
+    std::int64_t last = fields.back();
+    if (fields.size() > 3 || step <= 0 || first > last) {
+        std::cerr << "'" << range << "' is not a valid range" << std::endl;
+        std::exit(1);
+    }
+
+    std::vector<std::int64_t> values;
+    for (std::int64_t value = first; value <= last; value += step) {
+        values.push_back(value);
+    }
+    return values;
+}
+
+/**
+ * @brief Integral of cos(s w) over [w1, w2]
+ */
+static double integralCos(double s, double w1, double w2) {
+    if (s == 0.0) {
+        return w2 - w1;
+    }
+    return (std::sin(s * w2) - std::sin(s * w1)) / s;
+}
+
+/**
+ * @brief Integral of w cos(s w) over [w1, w2]
+ */
+static double integralWCos(double s, double w1, double w2) {
+    if (s == 0.0) {
+        return (w2 * w2 - w1 * w1) / 2.0;
+    }
+    return (std::cos(s * w2) + s * w2 * std::sin(s * w2) - std::cos(s * w1) - s * w1 * std::sin(s * w1)) / (s * s);
+}
+
+/**
+ * @brief Least square linear phase filter, as firls(order, [0 pass stop 1], [1 1 0 0])
+ * The amplitude is a sum of cos((order/2 - k) w) and the integrals of the
+ * normal equations are computed exactly on each band.
+ */
+static std::vector<double> designFirls(std::int64_t order, double passEdge, double stopEdge) {
+    const double bands[2][2] = { { 0.0, passEdge * M_PI }, { stopEdge * M_PI, M_PI } };
+    const double desired[2][2] = { { 1.0, 1.0 }, { 0.0, 0.0 } };
+
+    // Fréquences des cosinus de la réponse en amplitude
+    const std::int64_t nbTerm = order / 2 + 1;
+    std::vector<double> t(nbTerm);
+    for (std::int64_t k = 0; k < nbTerm; ++k) {
+        t[k] = order / 2.0 - k;
+    }
+
+    // Équations normales Q a = b
+    std::vector< std::vector<double> > q(nbTerm, std::vector<double>(nbTerm + 1, 0.0));
+    for (int band = 0; band < 2; ++band) {
+        const double w1 = bands[band][0];
+        const double w2 = bands[band][1];
+        const double slope = (desired[band][1] - desired[band][0]) / (w2 - w1);
+        const double offset = desired[band][0] - slope * w1;
+
+        for (std::int64_t k = 0; k < nbTerm; ++k) {
+            for (std::int64_t l = 0; l < nbTerm; ++l) {
+                q[k][l] += 0.5 * (integralCos(t[k] - t[l], w1, w2) + integralCos(t[k] + t[l], w1, w2));
+            }
+            q[k][nbTerm] += offset * integralCos(t[k], w1, w2) + slope * integralWCos(t[k], w1, w2);
+        }
+    }
+
+    // Élimination de Gauss avec pivot partiel
+    for (std::int64_t col = 0; col < nbTerm; ++col) {
+        std::int64_t pivot = col;
+        for (std::int64_t row = col + 1; row < nbTerm; ++row) {
+            if (std::fabs(q[row][col]) > std::fabs(q[pivot][col])) {
+                pivot = row;
+            }
+        }
+        std::swap(q[col], q[pivot]);
+
+        for (std::int64_t row = col + 1; row < nbTerm; ++row) {
+            const double factor = q[row][col] / q[col][col];
+            for (std::int64_t k = col; k <= nbTerm; ++k) {
+                q[row][k] -= factor * q[col][k];
+            }
+        }
+    }
+    std::vector<double> a(nbTerm);
+    for (std::int64_t row = nbTerm - 1; row >= 0; --row) {
+        double sum = q[row][nbTerm];
+        for (std::int64_t k = row + 1; k < nbTerm; ++k) {
+            sum -= q[row][k] * a[k];
+        }
+        a[row] = sum / q[row][row];
+    }
+
+    // Coefficients symétriques
+    std::vector<double> b(order + 1, 0.0);
+    for (std::int64_t k = 0; k < nbTerm; ++k) {
+        if (t[k] == 0.0) {
+            b[k] = a[k];
+        }
+        else {
+            b[k] = a[k] / 2.0;
+            b[order - k] = a[k] / 2.0;
+        }
+    }
+    return b;
+}
+
+/**
+ * @brief Low pass filter of Octave, as fir1(order, fc)
+ * Octave computes fir1 with fir2(order, [0 fc fc 1], [1 1 0 0], 512, 2): the
+ * response is sampled on 513 points with a ramp of 1/512 before fc, brought
+ * back to the time domain, then weighted by a Hamming window and scaled to a
+ * unit gain at DC.
+ */
+static std::vector<double> designFir1(std::int64_t order, double fc) {
+    constexpr std::int64_t GridSize = 512;
+    constexpr double Ramp = 1.0 / GridSize;
+
+    // Réponse échantillonnée, continue à droite en fc
+    std::vector<double> grid(GridSize + 1);
+    for (std::int64_t k = 0; k <= GridSize; ++k) {
+        const double f = static_cast<double>(k) / GridSize;
+        if (f <= fc - Ramp) {
+            grid[k] = 1.0;
+        }
+        else if (f < fc) {
+            grid[k] = (fc - f) / Ramp;
+        }
+        else {
+            grid[k] = 0.0;
+        }
+    }
+
+    // Transformée inverse du spectre symétrique (interpolé par 2 pour un ordre impair)
+    const std::int64_t length = (order % 2 == 0) ? 2 * GridSize : 4 * GridSize;
+    auto impulse = [&](std::int64_t t) {
+        double sum = grid[0];
+        for (std::int64_t k = 1; k < GridSize; ++k) {
+            sum += 2.0 * grid[k] * std::cos(2.0 * M_PI * k * t / length);
+        }
+        sum += grid[GridSize] * std::cos(2.0 * M_PI * GridSize * t / length);
+        return sum / length;
+    };
+
+    std::vector<double> b(order + 1);
+    double sum = 0.0;
+    for (std::int64_t k = 0; k <= order; ++k) {
+        const double value = (order % 2 == 0) ? impulse(k - order / 2) : 2.0 * impulse(2 * k - order);
+        const double window = (order == 0) ? 1.0 : 0.54 - 0.46 * std::cos(2.0 * M_PI * k / order);
+        b[k] = value * window;
+        sum += b[k];
+    }
+    for (double &value: b) {
+        value /= sum;
+    }
+    return b;
+}
+
+/**
+ * @brief Rejection of quantized coefficients, as rejection_criterion(freqz(b, 1, N))
+ * The N points of the response are the first half of an FFT of size 2N.
+ */
+static double computeRejection(const std::vector<std::int64_t> &coeffs, const Fft &fft, std::vector< std::complex<double> > &buffer, std::int64_t points, double fc) {
+    std::fill(buffer.begin(), buffer.end(), 0.0);
+    for (std::size_t k = 0; k < coeffs.size(); ++k) {
+        buffer[k % buffer.size()] += static_cast<double>(coeffs[k]);
+    }
+    fft.transform(buffer);
+
+    // Index de la fin de la bande passante et du début de la bande coupée
+    const std::int64_t indexBand = std::llround((fc - 0.1) * points);
+    const std::int64_t indexTail = std::llround((fc + 0.1) * points);
+
+    const double reference = std::abs(buffer[0]);
+    double bandMax = -std::numeric_limits<double>::infinity();
+    double bandMin = std::numeric_limits<double>::infinity();
+    double tailMax = -std::numeric_limits<double>::infinity();
+    for (std::int64_t m = 0; m < points; ++m) {
+        const double level = 20.0 * std::log10(std::abs(buffer[m]) / reference);
+        if (std::isnan(level)) {
+            continue;
+        }
+        if (m < indexBand) {
+            bandMax = std::max(bandMax, level);
+            bandMin = std::min(bandMin, level);
+        }
+        if (m >= indexTail) {
+            tailMax = std::max(tailMax, level);
+        }
+    }
+
+    return -(bandMax - bandMin) - tailMax;
+}
+
+/**
+ * @brief Scale to the max integer of nob bits, as round(b / max(b) * (2^(nob-1) - 1))
+ */
+static std::vector<std::int64_t> quantize(const std::vector<double> &b, std::int64_t nob) {
+    double maxCoeff = b.front();
+    for (double value: b) {
+        maxCoeff = std::max(maxCoeff, value);
+    }
+
+    const double scale = std::ldexp(1.0, nob - 1) - 1.0;
+    std::vector<std::int64_t> coeffs(b.size());
+    for (std::size_t k = 0; k < b.size(); ++k) {
+        coeffs[k] = std::llround(b[k] / maxCoeff * scale);
+    }
+    return coeffs;
+}
+
+/**
+ * @brief Path of a coefficient file, as Fir::getFilterName() in the directory
+ */
+static std::string coefficientPath(const std::string &directory, const std::string &method, std::int64_t nCoeff, std::int64_t nob) {
+    char filename[64] = {0};
+    std::snprintf(filename, sizeof(filename), "/%s_%03ld_int%02ld", method.c_str(), static_cast<long>(nCoeff), static_cast<long>(nob));
+
+    return directory + "/" + method + filename;
+}
+
+static bool writeCoefficients(const Settings &settings, std::int64_t nCoeff, std::int64_t nob, const std::vector<std::int64_t> &coeffs) {
+    std::ofstream file(coefficientPath(settings.coefficientsDirectory, settings.method, nCoeff, nob));
+    for (std::int64_t value: coeffs) {
+        file << value << "\n";
+    }
+    return file.good();
+}
+
+/**
+ * @brief Pack an existing library (JSON file, configuration files and coefficient files) in a filter bank
+ */
+static int packLibrary(const std::string &jsonPath, const std::string &coefficientsDirectory, const std::string &archiveFile) {
+    std::ifstream jsonFile(jsonPath);
+    if (jsonFile.fail()) {
+        std::cerr << "The json file '" << jsonPath << "' is missing" << std::endl;
+        return 1;
+    }
+    nlohmann::json jsonData;
+    jsonFile >> jsonData;
+
+    // Les fichiers de configuration sont relatifs au fichier JSON
+    const std::size_t slash = jsonPath.rfind('/');
+    const std::string jsonDirectory = (slash == std::string::npos) ? "." : jsonPath.substr(0, slash);
+
+    std::vector<FilterBankFamily> families;
+    std::size_t nbFilter = 0;
+    for (auto &element: jsonData.items()) {
+        const std::string configurationFile = jsonDirectory + "/" + static_cast<std::string>(element.value());
+        MappedFile configuration(configurationFile);
+        if (!configuration.isOpen()) {
+            std::cerr << "The file '" << configurationFile << "' is missing" << std::endl;
+            return 1;
+        }
+
+        FilterBankFamily family;
+        family.name = element.key();
+
+        // Même format que loadFirConfiguration : nob, nombre de coefficients, rejection
+        constexpr std::size_t RecordSize = 2 * sizeof(std::uint16_t) + sizeof(double);
+        for (std::size_t offset = 0; offset + RecordSize <= configuration.getSize(); offset += RecordSize) {
+            FilterBankFilter filter;
+            std::memcpy(&filter.piC, configuration.getData() + offset, sizeof(std::uint16_t));
+            std::memcpy(&filter.cardC, configuration.getData() + offset + sizeof(std::uint16_t), sizeof(std::uint16_t));
+            std::memcpy(&filter.rejection, configuration.getData() + offset + 2 * sizeof(std::uint16_t), sizeof(double));
+
+            const std::string path = coefficientPath(coefficientsDirectory, family.name, filter.cardC, filter.piC);
+            std::ifstream coeffFile(path);
+            if (coeffFile.fail()) {
+                std::cerr << "The coefficient file '" << path << "' is missing" << std::endl;
+                return 1;
+            }
+            std::int64_t coeff = 0;
+            while (coeffFile >> coeff) {
+                if (coeff < std::numeric_limits<std::int32_t>::min() || coeff > std::numeric_limits<std::int32_t>::max()) {
+                    std::cerr << "The coefficients of '" << path << "' do not fit on 32 bits" << std::endl;
+                    return 1;
+                }
+                filter.taps.push_back(coeff);
+            }
+
+            family.filters.push_back(filter);
+        }
+
+        nbFilter += family.filters.size();
+        families.push_back(family);
+    }
+
+    if (!FilterBank::write(archiveFile, families)) {
+        return 1;
+    }
+
+    std::cout << "Filters: " << nbFilter << " (" << families.size() << " families)" << std::endl;
+
+    return 0;
+}
+
+/**
+ * @brief Write the response cache of all the filters of a filter bank
+ */
+static int writeResponses(const Settings &settings) {
+    FilterBank bank(settings.responsesBank);
+    if (!bank.isOpen()) {
+        std::cerr << "The filter bank '" << settings.responsesBank << "' is missing or not valid" << std::endl;
+        return 1;
+    }
+
+    std::vector< std::vector<std::int64_t> > filters(bank.getNbFilter());
+    for (std::size_t i = 0; i < bank.getNbFilter(); ++i) {
+        const std::int32_t *taps = bank.getTaps(i);
+        filters[i].assign(taps, taps + bank.getEntry(i).cardC);
+    }
+
+    if (!ResponseCache::write(settings.outputFile, settings.points, filters)) {
+        return 1;
+    }
+
+    ResponseCache cache(settings.outputFile);
+    std::cout << "Responses: " << (cache.isOpen() ? cache.getNbResponse() : 0) << " for " << filters.size() << " filters (" << settings.points << " points)" << std::endl;
+
+    return 0;
+}
+
+static void printUsage(const char *program) {
+    std::cerr << "Usage:" << std::endl;
+    std::cerr << "\t" << program << " [--method firls|fir1] [--coeffs FIRST:STEP:LAST] [--bits FIRST:LAST] [--band PASS,STOP] [--fc FC] [--points N] [--threads NUMBER_THREAD] [--coefficients DIRECTORY] [--archive ARCHIVE_FILE] OUTPUT_FILE" << std::endl;
+    std::cerr << "\t" << program << " --pack JSON_FILTERS_FILE COEFFICIENT_DIRECTORY ARCHIVE_FILE" << std::endl;
+    std::cerr << "\t" << program << " [--points N] --responses ARCHIVE_FILE RESPONSE_CACHE_FILE" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    Settings settings;
+    std::string coeffs;
+    std::string bits;
+
+    // Conversion d'une bibliothèque existante
+    if (argc > 1 && std::string(argv[1]) == "--pack") {
+        if (argc != 5) {
+            std::cerr << "Wrong parameters" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        return packLibrary(argv[2], argv[3], argv[4]);
+    }
+
+    int parameter = 1;
+    for (; parameter + 1 < argc; parameter += 2) {
+        const std::string option = argv[parameter];
+        const std::string value = argv[parameter + 1];
+        if (option == "--method") {
+            settings.method = value;
+        }
+        else if (option == "--coeffs") {
+            coeffs = value;
+        }
+        else if (option == "--bits") {
+            bits = value;
+        }
+        else if (option == "--band") {
+            settings.passEdge = std::atof(value.c_str());
+            settings.stopEdge = std::atof(value.substr(value.find(',') + 1).c_str());
+        }
+        else if (option == "--fc") {
+            settings.fc = std::atof(value.c_str());
+        }
+        else if (option == "--points") {
+            settings.points = std::atoll(value.c_str());
+        }
+        else if (option == "--threads") {
+            settings.threads = std::atoll(value.c_str());
+        }
+        else if (option == "--coefficients") {
+            settings.coefficientsDirectory = value;
+        }
+        else if (option == "--archive") {
+            settings.archiveFile = value;
+        }
+        else if (option == "--responses") {
+            settings.responsesBank = value;
+        }
+        else {
+            break;
+        }
+    }
+
+    if (parameter + 1 != argc) {
+        std::cerr << "Wrong parameters" << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Une option (--help ou inconnue) n'est pas un fichier de sortie
+    const std::string outputFile = argv[parameter];
+    if (outputFile == "-h" || outputFile.compare(0, 2, "--") == 0) {
+        if (outputFile != "-h" && outputFile != "--help") {
+            std::cerr << "'" << outputFile << "' is not a valid option" << std::endl;
+        }
+        printUsage(argv[0]);
+        return 1;
+    }
+    settings.outputFile = outputFile;
+
+    // Cache des réponses d'une archive existante
+    if (!settings.responsesBank.empty()) {
+        return writeResponses(settings);
+    }
+
+    // Grilles par défaut des scripts generate_firls.m et generate_fir1.m
+    if (settings.method == "firls") {
+        settings.coeffs = parseRange(coeffs.empty() ? "3:2:60" : coeffs);
+        settings.bits = parseRange(bits.empty() ? "2:22" : bits);
+    }
+    else if (settings.method == "fir1") {
+        settings.coeffs = parseRange(coeffs.empty() ? "3:60" : coeffs);
+        settings.bits = parseRange(bits.empty() ? "2:18" : bits);
+    }
+    else {
+        std::cerr << "'" << settings.method << "' is not a valid method" << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::size_t fftSize = 1;
+    while (fftSize < static_cast<std::size_t>(2 * settings.points)) {
+        fftSize <<= 1;
+    }
+    if (fftSize != static_cast<std::size_t>(2 * settings.points)) {
+        std::cerr << "The number of points must be a power of two" << std::endl;
+        return 1;
+    }
+
+    if (!settings.coefficientsDirectory.empty()) {
+        ::mkdir(settings.coefficientsDirectory.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+        ::mkdir((settings.coefficientsDirectory + "/" + settings.method).c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+    }
+
+    // Un filtre flottant par nombre de coefficients, quantifié sur tous les nombres de bits
+    const std::size_t nbCoeff = settings.coeffs.size();
+    const std::size_t nbBit = settings.bits.size();
+    std::vector<double> rejections(nbCoeff * nbBit);
+    std::vector< std::vector<std::int32_t> > taps(settings.archiveFile.empty() ? 0 : nbCoeff * nbBit);
+    std::atomic<std::size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::atomic<bool> tooWide(false);
+    const Fft fft(fftSize);
+
+    auto worker = [&]() {
+        std::vector< std::complex<double> > buffer(fftSize);
+        for (std::size_t c = next++; c < nbCoeff; c = next++) {
+            const std::int64_t nCoeff = settings.coeffs[c];
+            // Les bibliothèques existantes de firls correspondent à un filtre de nCoeff coefficients
+            const std::vector<double> b = (settings.method == "firls") ? designFirls(nCoeff - 1, settings.passEdge, settings.stopEdge) : designFir1(nCoeff - 1, settings.fc);
+
+            for (std::size_t n = 0; n < nbBit; ++n) {
+                const std::vector<std::int64_t> quantized = quantize(b, settings.bits[n]);
+                rejections[c * nbBit + n] = computeRejection(quantized, fft, buffer, settings.points, settings.fc);
+
+                if (!settings.coefficientsDirectory.empty() && !writeCoefficients(settings, nCoeff, settings.bits[n], quantized)) {
+                    failed = true;
+                }
+                if (!settings.archiveFile.empty()) {
+                    // Les coefficients de l'archive sont sur 32 bits, comme avec --pack
+                    for (std::int64_t coeff: quantized) {
+                        if (coeff < std::numeric_limits<std::int32_t>::min() || coeff > std::numeric_limits<std::int32_t>::max()) {
+                            tooWide = true;
+                        }
+                    }
+                    taps[c * nbBit + n].assign(quantized.begin(), quantized.end());
+                }
+            }
+        }
+    };
+
+    std::size_t nbThread = (settings.threads == 0) ? std::thread::hardware_concurrency() : settings.threads;
+    nbThread = std::max<std::size_t>(1, std::min(nbThread, nbCoeff));
+    std::vector<std::thread> pool;
+    for (std::size_t i = 0; i < nbThread; ++i) {
+        pool.emplace_back(worker);
+    }
+    for (std::thread &thread: pool) {
+        thread.join();
+    }
+
+    if (failed) {
+        std::cerr << "Write coefficient files in '" << settings.coefficientsDirectory << "': failed" << std::endl;
+        return 1;
+    }
+    if (tooWide) {
+        std::cerr << "The coefficients of the archive '" << settings.archiveFile << "' do not fit on 32 bits" << std::endl;
+        return 1;
+    }
+
+    // Même format que loadFirConfiguration : nob, nombre de coefficients, rejection
+    std::ofstream file(settings.outputFile, std::ios::binary);
+    for (std::size_t n = 0; n < nbBit; ++n) {
+        for (std::size_t c = 0; c < nbCoeff; ++c) {
+            const std::uint16_t nob = settings.bits[n];
+            const std::uint16_t nCoeff = settings.coeffs[c];
+            const double rejection = rejections[c * nbBit + n];
+            file.write(reinterpret_cast<const char *>(&nob), sizeof(nob));
+            file.write(reinterpret_cast<const char *>(&nCoeff), sizeof(nCoeff));
+            file.write(reinterpret_cast<const char *>(&rejection), sizeof(rejection));
+        }
+    }
+    if (!file.good()) {
+        std::cerr << "Write '" << settings.outputFile << "': failed" << std::endl;
+        return 1;
+    }
+
+    // Une seule famille dans l'archive, dans l'ordre du fichier de sortie
+    if (!settings.archiveFile.empty()) {
+        FilterBankFamily family;
+        family.name = settings.method;
+        for (std::size_t n = 0; n < nbBit; ++n) {
+            for (std::size_t c = 0; c < nbCoeff; ++c) {
+                FilterBankFilter filter = { static_cast<std::uint16_t>(settings.bits[n]), static_cast<std::uint16_t>(settings.coeffs[c]), rejections[c * nbBit + n], taps[c * nbBit + n] };
+                family.filters.push_back(filter);
+            }
+        }
+        if (!FilterBank::write(settings.archiveFile, std::vector<FilterBankFamily>(1, family))) {
+            return 1;
+        }
+    }
+
+    std::cout << "Filters: " << nbCoeff * nbBit << " (" << nbThread << " threads)" << std::endl;
+
+    return 0;
+}